@@ -0,0 +1,46 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace {
+
+constexpr std::size_t alignment = alignof(std::max_align_t);
+// Blocks start small enough for a REPL line and double up to the maximum, so
+// a big program needs only a few dozen of them.
+constexpr std::size_t firstBlockSize = 16 * 1024;
+constexpr std::size_t maxBlockSize = 1024 * 1024;
+
+thread_local Arena *activeArena = nullptr;
+
+} // namespace
+
+Arena::Arena()
+    : blocks{}, next{nullptr}, left{0}, blockSize{firstBlockSize}, used{0} {}
+
+void *Arena::allocate(std::size_t size) {
+  size = (size + alignment - 1) & ~(alignment - 1);
+  if (size > left) {
+    std::size_t newSize = std::max(blockSize, size);
+    // new[] of char is only aligned for char, so over-allocate and align.
+    // Not make_unique, which would zero the block first.
+    blocks.emplace_back(new char[newSize + alignment]);
+    std::size_t address = reinterpret_cast<std::size_t>(blocks.back().get());
+    next = blocks.back().get() + (alignment - address % alignment) % alignment;
+    left = newSize;
+    blockSize = std::min(blockSize * 2, maxBlockSize);
+  }
+  void *allocation = next;
+  next += size;
+  left -= size;
+  used += size;
+  return allocation;
+}
+
+ArenaScope::ArenaScope(Arena &arena) : previous{activeArena} {
+  activeArena = &arena;
+}
+
+ArenaScope::~ArenaScope() { activeArena = previous; }
+
+Arena *currentArena() { return activeArena; }
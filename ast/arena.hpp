@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// A bump allocator for AST nodes. Allocating is moving a pointer through the
+// current block and nothing is freed on its own: destroying the arena drops
+// all of its blocks at once. Nodes allocated one after the other end up next
+// to each other, in the order the parser built them.
+class Arena {
+private:
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char *next;
+  std::size_t left;
+  std::size_t blockSize;
+  std::size_t used;
+
+public:
+  Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // Returns size bytes aligned for any type.
+  void *allocate(std::size_t size);
+
+  // Bytes handed out by allocate(), alignment padding included.
+  std::size_t bytesUsed() const { return used; }
+  std::size_t blockCount() const { return blocks.size(); }
+};
+
+// While an ArenaScope is alive, AST nodes created on its thread come from its
+// arena instead of the heap. Scopes nest; destroying one makes the enclosing
+// scope's arena, or the heap, current again.
+class ArenaScope {
+private:
+  Arena *previous;
+
+public:
+  explicit ArenaScope(Arena &arena);
+  ~ArenaScope();
+
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+};
+
+// The arena of the innermost ArenaScope on this thread, or null.
+Arena *currentArena();
@@ -1,6 +1,35 @@
 #include "ast.hpp"
 #include "../token/token.hpp"
+#include "arena.hpp"
+#include <cstddef>
+#include <new>
 #include <string>
+#include <string_view>
+
+namespace {
+
+// Every node is preceded by the arena it came from, null for the heap. The
+// header keeps the node aligned as operator new promises.
+constexpr std::size_t headerSize = alignof(std::max_align_t);
+static_assert(sizeof(Arena *) <= headerSize);
+
+} // namespace
+
+void *Node::operator new(std::size_t size) {
+  Arena *arena = currentArena();
+  char *allocation =
+      static_cast<char *>(arena != nullptr ? arena->allocate(headerSize + size)
+                                           : ::operator new(headerSize + size));
+  *reinterpret_cast<Arena **>(allocation) = arena;
+  return allocation + headerSize;
+}
+
+void Node::operator delete(void *ptr, std::size_t) {
+  char *allocation = static_cast<char *>(ptr) - headerSize;
+  if (*reinterpret_cast<Arena **>(allocation) == nullptr) {
+    ::operator delete(allocation);
+  }
+}
 
 std::string Program::TokenLiteral() {
   if (statements.size() > 0) {
@@ -24,12 +53,12 @@ void Expression::expressionNode() {}
 std::string Expression::TokenLiteral() { return ""; }
 
 LetStatement::LetStatement(Token &token) : token{token} {};
-std::string LetStatement::TokenLiteral() { return token.Literal; }
+std::string LetStatement::TokenLiteral() { return std::string(token.Literal); }
 void LetStatement::statementNode() {}
 std::string LetStatement::String() {
   std::string info{};
-  info += token.Literal + " ";
-  info += name->value + " = ";
+  info += std::string(token.Literal) + " ";
+  info += std::string(name->value) + " = ";
   if (value != nullptr) {
     info += value->String();
   }
@@ -37,17 +66,20 @@ std::string LetStatement::String() {
   return info;
 }
 
-Identifier::Identifier(const Token &t, std::string &s) : token{t}, value{s} {};
-std::string Identifier::TokenLiteral() { return token.Literal; }
+Identifier::Identifier(const Token &t, SymbolId s)
+    : token{t}, value{t.Literal}, symbol{s} {};
+std::string Identifier::TokenLiteral() { return std::string(token.Literal); }
 void Identifier::expressionNode() {}
-std::string Identifier::String() { return value; }
+std::string Identifier::String() { return std::string(value); }
 
 ReturnStatement::ReturnStatement(Token &t) : token{t} {}
 void ReturnStatement::statementNode() {}
-std::string ReturnStatement::TokenLiteral() { return token.Literal; }
+std::string ReturnStatement::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string ReturnStatement::String() {
   std::string info{};
-  info += token.Literal + " ";
+  info += std::string(token.Literal) + " ";
 
   if (returnValue != nullptr) {
     info += returnValue->String();
@@ -63,7 +95,9 @@ ExpressionStatement::ExpressionStatement(Token &t,
                                          std::unique_ptr<Expression> e)
     : token{t}, expression{std::move(e)} {}
 void ExpressionStatement::statementNode() {}
-std::string ExpressionStatement::TokenLiteral() { return token.Literal; }
+std::string ExpressionStatement::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string ExpressionStatement::String() {
   if (expression != nullptr) {
     return expression->String();
@@ -71,16 +105,43 @@ std::string ExpressionStatement::String() {
   return "";
 }
 
-IntegerLiteral::IntegerLiteral(Token &t, int v) : token{t}, value{v} {}
+IntegerLiteral::IntegerLiteral(Token &t, std::int64_t v) : token{t}, value{v} {}
 void IntegerLiteral::expressionNode() {}
-std::string IntegerLiteral::TokenLiteral() { return token.Literal; }
+std::string IntegerLiteral::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string IntegerLiteral::String() { return std::to_string(value); }
 
+FloatLiteral::FloatLiteral(Token &t, double v) : token{t}, value{v} {}
+void FloatLiteral::expressionNode() {}
+std::string FloatLiteral::TokenLiteral() { return std::string(token.Literal); }
+std::string FloatLiteral::String() { return std::string(token.Literal); }
+
+StringLiteral::StringLiteral(Token &t)
+    : decoded{}, isDecoded{false}, token{t} {}
+std::string_view StringLiteral::value() {
+  if (!token.HasEscapes) {
+    return stringLiteralBody(token.Literal);
+  }
+  if (!isDecoded) {
+    decoded = decodeEscapes(stringLiteralBody(token.Literal));
+    isDecoded = true;
+  }
+  return decoded;
+}
+void StringLiteral::expressionNode() {}
+std::string StringLiteral::TokenLiteral() {
+  return std::string(token.Literal);
+}
+std::string StringLiteral::String() { return std::string(token.Literal); }
+
 PrefixExpression::PrefixExpression(Token &token, std::string operator_,
                                    std::unique_ptr<Expression> right)
     : token{token}, operator_{operator_}, right{std::move(right)} {}
 void PrefixExpression::expressionNode() {}
-std::string PrefixExpression::TokenLiteral() { return token.Literal; }
+std::string PrefixExpression::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string PrefixExpression::String() {
   std::string info = "(" + operator_ + right->String() + ")";
   return info;
@@ -92,7 +153,9 @@ InfixExpression::InfixExpression(Token &token, std::unique_ptr<Expression> left,
     : token{token}, left{std::move(left)}, operator_{operator_},
       right{std::move(right)} {}
 void InfixExpression::expressionNode() {}
-std::string InfixExpression::TokenLiteral() { return token.Literal; }
+std::string InfixExpression::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string InfixExpression::String() {
   std::string info =
       "(" + left->String() + " " + operator_ + " " + right->String() + ")";
@@ -101,8 +164,8 @@ std::string InfixExpression::String() {
 
 Boolean::Boolean(Token &token, bool value) : token{token}, value{value} {}
 void Boolean::expressionNode() {}
-std::string Boolean::TokenLiteral() { return token.Literal; }
-std::string Boolean::String() { return token.Literal; }
+std::string Boolean::TokenLiteral() { return std::string(token.Literal); }
+std::string Boolean::String() { return std::string(token.Literal); }
 
 IfExpression::IfExpression(Token &token) : token{token} {}
 IfExpression::IfExpression(Token &token, std::unique_ptr<Expression> condition,
@@ -117,7 +180,7 @@ IfExpression::IfExpression(Token &token, std::unique_ptr<Expression> condition,
 }
 
 void IfExpression::expressionNode() {}
-std::string IfExpression::TokenLiteral() { return token.Literal; }
+std::string IfExpression::TokenLiteral() { return std::string(token.Literal); }
 std::string IfExpression::String() {
   std::string info = "if" + condition->String() + " " + consequence->String();
   if (alternative != nullptr) {
@@ -132,7 +195,9 @@ BlockStatement::BlockStatement(
     Token &token, std::vector<std::unique_ptr<Statement>> &statements)
     : token{token}, statements{std::move(statements)} {}
 void BlockStatement::statementNode() {}
-std::string BlockStatement::TokenLiteral() { return token.Literal; }
+std::string BlockStatement::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string BlockStatement::String() {
   std::string info{};
   for (auto &&statement : statements) {
@@ -144,7 +209,9 @@ std::string BlockStatement::String() {
 FunctionLiteral::FunctionLiteral(Token &token)
     : token{token}, parameters{}, body{nullptr} {}
 void FunctionLiteral::expressionNode() {}
-std::string FunctionLiteral::TokenLiteral() { return token.Literal; }
+std::string FunctionLiteral::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string FunctionLiteral::String() {
   std::string info = TokenLiteral() + "(";
 
@@ -168,7 +235,9 @@ callExpression::callExpression(Token &token,
                                std::unique_ptr<Expression> function)
     : token{token}, function{std::move(function)}, arguments{} {}
 void callExpression::expressionNode() {}
-std::string callExpression::TokenLiteral() { return token.Literal; }
+std::string callExpression::TokenLiteral() {
+  return std::string(token.Literal);
+}
 std::string callExpression::String() {
   std::string info{};
   info += function->String();
@@ -1,7 +1,10 @@
 #pragma once
 #include "../token/token.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Node {
@@ -9,6 +12,13 @@ public:
   virtual std::string TokenLiteral() = 0;
   virtual std::string String() = 0;
   virtual ~Node() = default;
+
+  // Nodes are allocated from the current Arena (see ArenaScope) if there is
+  // one, else from the heap. Each allocation records where it came from, so
+  // deleting a node through a unique_ptr works either way: heap memory is
+  // freed, arena memory is left for the arena to drop.
+  static void *operator new(std::size_t size);
+  static void operator delete(void *ptr, std::size_t size);
 };
 
 class Statement : public Node {
@@ -32,9 +42,12 @@ public:
 
 class Identifier : public Expression {
 public:
-  Identifier(const Token &, std::string &);
+  Identifier(const Token &, SymbolId);
   Token token;
-  std::string value;
+  // View of the name in the source, like token.Literal
+  std::string_view value;
+  // Id of the name in the parser's Interner; equal names have equal symbols
+  SymbolId symbol;
 
   void expressionNode() override;
   std::string TokenLiteral() override;
@@ -79,8 +92,40 @@ public:
 class IntegerLiteral : public Expression {
 public:
   Token token;
-  int value;
-  IntegerLiteral(Token &, int);
+  std::int64_t value;
+  IntegerLiteral(Token &, std::int64_t);
+
+  void expressionNode() override;
+  std::string TokenLiteral() override;
+  std::string String() override;
+};
+
+class FloatLiteral : public Expression {
+public:
+  Token token;
+  double value;
+  FloatLiteral(Token &, double);
+
+  void expressionNode() override;
+  std::string TokenLiteral() override;
+  // The literal as written, so that it reads back as a FLOAT
+  std::string String() override;
+};
+
+// Keeps the raw text of the literal; the escapes are only decoded the first
+// time value() is called, and a literal without escapes never allocates.
+class StringLiteral : public Expression {
+private:
+  std::string decoded;
+  bool isDecoded;
+
+public:
+  Token token;
+  StringLiteral(Token &);
+
+  // The text between the quotes with escapes decoded. Valid as long as both
+  // the node and the source are.
+  std::string_view value();
 
   void expressionNode() override;
   std::string TokenLiteral() override;
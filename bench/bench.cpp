@@ -0,0 +1,591 @@
+#include "../ast/ast.hpp"
+#include "../lexer/lexer.hpp"
+#include "../lexer/pipelined_lexer.hpp"
+#include "../lexer/relex.hpp"
+#include "../lexer/stream_lexer.hpp"
+#include "../lexer/token_buffer.hpp"
+#include "../parser/parser.hpp"
+#include "../source/source_file.hpp"
+#include "../source/token_cache.hpp"
+#include "../token/interner.hpp"
+#include "../token/token.hpp"
+#include "corpus.hpp"
+#include "counting_alloc.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename L = Lexer>
+void benchLexer(const char *name, const std::string &source,
+                int iterations) {
+  std::size_t tokens = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    L l{source};
+    while (l.nextToken().Type != TokenKind::EOF_) {
+      ++tokens;
+    }
+  }
+  double seconds = secondsSince(start);
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("lexer (%s): %10.2f MB/s  %12.0f tokens/s\n", name,
+              megabytes / seconds, tokens / seconds);
+}
+
+// Lexing with an Interner; all iterations share it, as a long running process
+// would, so after the first pass every identifier is a hit.
+void benchInterningLexer(const std::string &source, int iterations) {
+  Interner symbols{};
+  std::size_t tokens = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    Lexer l{source, symbols};
+    while (l.nextToken().Type != TokenKind::EOF_) {
+      ++tokens;
+    }
+  }
+  double seconds = secondsSince(start);
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("lexer (interning): %10.2f MB/s  %12.0f tokens/s  %zu symbols\n",
+              megabytes / seconds, tokens / seconds, symbols.size());
+}
+
+void benchTokenize(const std::string &source, int iterations) {
+  std::size_t tokens = 0;
+  std::size_t bytes = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    TokenBuffer buffer = tokenize(source);
+    tokens += buffer.size();
+    bytes += buffer.size() * TokenBuffer::bytesPerToken;
+  }
+  double seconds = secondsSince(start);
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("tokenize: %10.2f MB/s  %12.0f tokens/s  %.1f bytes/token\n",
+              megabytes / seconds, tokens / seconds, double(bytes) / tokens);
+}
+
+void benchParser(const std::string &source, int iterations) {
+  std::size_t statements = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    Lexer l{source};
+    Parser p{&l};
+    statements += p.parseProgram()->statements.size();
+  }
+  double seconds = secondsSince(start);
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("parser: %10.2f MB/s  %12.0f statements/s\n",
+              megabytes / seconds, statements / seconds);
+
+  TokenBuffer tokens = tokenize(source);
+  statements = 0;
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    TokenBufferReader reader{tokens};
+    Parser p{&reader};
+    statements += p.parseProgram()->statements.size();
+  }
+  seconds = secondsSince(start);
+  std::printf("parser (token buffer): %10.2f MB/s  %12.0f statements/s\n",
+              megabytes / seconds, statements / seconds);
+
+  // Only faster than the plain parser with a second core to lex on
+  statements = 0;
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    PipelinedLexer l{source};
+    Parser p{&l};
+    statements += p.parseProgram()->statements.size();
+  }
+  seconds = secondsSince(start);
+  std::printf("parser (pipelined): %10.2f MB/s  %12.0f statements/s\n",
+              megabytes / seconds, statements / seconds);
+}
+
+void benchParallelTokenize(const char *name, const std::string &source,
+                           int iterations) {
+  double baseline = 0;
+  for (unsigned threads : {1, 2, 4, 8}) {
+    std::size_t tokens = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      tokens += tokenizeParallel(source, threads).size();
+    }
+    double seconds = secondsSince(start);
+    if (threads == 1) {
+      baseline = seconds;
+    }
+    double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+    std::printf("tokenize (%s) %u threads: %10.2f MB/s  speedup %.2fx\n",
+                name, threads, megabytes / seconds, baseline / seconds);
+  }
+}
+
+// Typing one charachter at a time in the middle of the corpus, re-lexing
+// incrementally versus tokenizing the whole file after every keystroke.
+void benchRelex(std::string source) {
+  constexpr int keystrokes = 200;
+  TokenBuffer tokens = tokenize(source);
+  std::size_t offset = source.find("alpha", source.size() / 2);
+
+  auto start = Clock::now();
+  for (int i = 0; i < keystrokes; ++i) {
+    relex(tokens, source, {offset + i, 0, "x"});
+  }
+  double relexSeconds = secondsSince(start);
+
+  start = Clock::now();
+  for (int i = 0; i < keystrokes; ++i) {
+    source.insert(offset + i, "x");
+    tokens = tokenize(source);
+  }
+  double fullSeconds = secondsSince(start);
+
+  std::printf("edit: relex %10.2f us/keystroke, full tokenize %10.2f "
+              "us/keystroke\n",
+              relexSeconds * 1e6 / keystrokes, fullSeconds * 1e6 / keystrokes);
+}
+
+void benchStreamLexer(const std::string &source, int iterations) {
+  std::size_t tokens = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    std::istringstream in{source};
+    StreamLexer l{in};
+    while (l.nextToken().Type != TokenKind::EOF_) {
+      ++tokens;
+    }
+  }
+  double seconds = secondsSince(start);
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("stream lexer: %10.2f MB/s  %12.0f tokens/s\n",
+              megabytes / seconds, tokens / seconds);
+}
+
+// Loading a script by reading it into a string versus mapping it, both
+// followed by a full tokenize.
+void benchSourceFile(const std::string &source, int iterations) {
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "monkey_bench_corpus.mk";
+  {
+    std::ofstream out{path, std::ios::binary};
+    out << source;
+  }
+
+  std::size_t tokens = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    std::ifstream in{path, std::ios::binary};
+    std::string contents{std::istreambuf_iterator<char>(in),
+                         std::istreambuf_iterator<char>()};
+    tokens += tokenize(contents).size();
+  }
+  double readSeconds = secondsSince(start);
+
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    SourceFile file{path.string()};
+    tokens += tokenize(file.view()).size();
+  }
+  double mapSeconds = secondsSince(start);
+
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("load+tokenize: read %10.2f MB/s, mmap %10.2f MB/s\n",
+              megabytes / readSeconds, megabytes / mapSeconds);
+  std::filesystem::remove(path);
+}
+
+void benchTokenCache(const std::string &source, int iterations) {
+  std::string cachePath =
+      (std::filesystem::temp_directory_path() / "monkey_bench_corpus.tokens")
+          .string();
+  std::filesystem::remove(cachePath);
+  tokenizeCached(source, cachePath);
+
+  std::size_t tokens = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    tokens += tokenizeCached(source, cachePath).size();
+  }
+  double hitSeconds = secondsSince(start);
+
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    tokens += tokenize(source).size();
+  }
+  double lexSeconds = secondsSince(start);
+
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("token cache: hit %10.2f MB/s, tokenize %10.2f MB/s, "
+              "%zu bytes on disk\n",
+              megabytes / hitSeconds, megabytes / lexSeconds,
+              static_cast<std::size_t>(std::filesystem::file_size(cachePath)));
+  std::filesystem::remove(cachePath);
+}
+
+// The keyword map the lexer used before lookupIdent, kept here to compare
+// against.
+TokenKind lookupIdentMap(const std::string &ident) {
+  static const std::unordered_map<std::string, TokenKind> keywordMap{
+      {"fn", TokenKind::FUNCTION}, {"let", TokenKind::LET},
+      {"true", TokenKind::TRUE},   {"false", TokenKind::FALSE},
+      {"if", TokenKind::IF},       {"else", TokenKind::ELSE},
+      {"return", TokenKind::RETURN},
+  };
+  if (auto search = keywordMap.find(ident); search != keywordMap.end()) {
+    return search->second;
+  }
+  return TokenKind::IDENT;
+}
+
+void benchKeywords(const std::string &source, int iterations) {
+  std::vector<std::string_view> words{};
+  Lexer l{source};
+  for (Token token = l.nextToken(); token.Type != TokenKind::EOF_;
+       token = l.nextToken()) {
+    // Identifiers and keywords are the tokens that start with a letter
+    if (isLetter(token.Literal.front())) {
+      words.push_back(token.Literal);
+    }
+  }
+
+  std::size_t keywordsFound = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (auto word : words) {
+      keywordsFound += lookupIdentMap(std::string(word)) != TokenKind::IDENT;
+    }
+  }
+  double mapSeconds = secondsSince(start);
+
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (auto word : words) {
+      keywordsFound += lookupIdent(word) != TokenKind::IDENT;
+    }
+  }
+  double hashSeconds = secondsSince(start);
+
+  double lookups = double(words.size()) * iterations;
+  std::printf("keywords: map %10.0f lookups/s, perfect hash %10.0f lookups/s"
+              " (%zu hits)\n",
+              lookups / mapSeconds, lookups / hashSeconds, keywordsFound);
+}
+
+// Number of AST nodes under node, itself included.
+std::size_t countNodes(Node *node) {
+  if (node == nullptr) {
+    return 0;
+  }
+  std::size_t count = 1;
+  if (auto *program = dynamic_cast<Program *>(node)) {
+    for (auto &&statement : program->statements) {
+      count += countNodes(statement.get());
+    }
+  } else if (auto *let = dynamic_cast<LetStatement *>(node)) {
+    count += countNodes(let->name.get()) + countNodes(let->value.get());
+  } else if (auto *ret = dynamic_cast<ReturnStatement *>(node)) {
+    count += countNodes(ret->returnValue.get());
+  } else if (auto *stmt = dynamic_cast<ExpressionStatement *>(node)) {
+    count += countNodes(stmt->expression.get());
+  } else if (auto *block = dynamic_cast<BlockStatement *>(node)) {
+    for (auto &&statement : block->statements) {
+      count += countNodes(statement.get());
+    }
+  } else if (auto *prefix = dynamic_cast<PrefixExpression *>(node)) {
+    count += countNodes(prefix->right.get());
+  } else if (auto *infix = dynamic_cast<InfixExpression *>(node)) {
+    count += countNodes(infix->left.get()) + countNodes(infix->right.get());
+  } else if (auto *ifExpr = dynamic_cast<IfExpression *>(node)) {
+    count += countNodes(ifExpr->condition.get()) +
+             countNodes(ifExpr->consequence.get()) +
+             countNodes(ifExpr->alternative.get());
+  } else if (auto *fn = dynamic_cast<FunctionLiteral *>(node)) {
+    for (auto &&parameter : fn->parameters) {
+      count += countNodes(parameter.get());
+    }
+    count += countNodes(fn->body.get());
+  } else if (auto *call = dynamic_cast<callExpression *>(node)) {
+    count += countNodes(call->function.get());
+    for (auto &&argument : call->arguments) {
+      count += countNodes(argument.get());
+    }
+  }
+  return count;
+}
+
+// Runs work until minSeconds have passed, at least once, and returns the
+// time of the fastest run. The fastest run is the least disturbed by the
+// rest of the machine, which keeps numbers comparable between versions.
+// reset runs untimed before every run.
+template <typename Work, typename Reset>
+double fastestRun(double minSeconds, Work &&work, Reset &&reset) {
+  double fastest = 0;
+  auto begin = Clock::now();
+  do {
+    reset();
+    auto start = Clock::now();
+    work();
+    double seconds = secondsSince(start);
+    fastest = fastest == 0 ? seconds : std::min(fastest, seconds);
+  } while (secondsSince(begin) < minSeconds);
+  return fastest;
+}
+
+template <typename Work> double fastestRun(double minSeconds, Work &&work) {
+  return fastestRun(minSeconds, work, [] {});
+}
+
+struct CorpusResult {
+  std::string name;
+  std::size_t bytes;
+  std::uint64_t hash;
+  std::size_t tokens;
+  std::size_t nodes;
+  double lexerSeconds;
+  double tokenizeSeconds;
+  double parserSeconds;
+  double allocationsPerNode;
+  // The same with the AST in an arena (Parser::parseProgramInArena)
+  double arenaParserSeconds;
+  double arenaAllocationsPerNode;
+};
+
+CorpusResult benchCorpus(const Corpus &corpus, double minSeconds) {
+  const std::string &source = corpus.source;
+  CorpusResult result{};
+  result.name = corpus.name;
+  result.bytes = source.size();
+  result.hash = contentHash(source);
+
+  result.lexerSeconds = fastestRun(minSeconds, [&] {
+    Lexer l{source};
+    std::size_t tokens = 1;
+    while (l.nextToken().Type != TokenKind::EOF_) {
+      ++tokens;
+    }
+    result.tokens = tokens;
+  });
+  result.tokenizeSeconds =
+      fastestRun(minSeconds, [&] { tokenize(source).size(); });
+
+  // Parsing includes lexing, as in the REPL; freeing the AST is not timed
+  std::unique_ptr<Program> program{};
+  result.parserSeconds = fastestRun(
+      minSeconds,
+      [&] {
+        Lexer l{source};
+        Parser p{&l};
+        program = p.parseProgram();
+      },
+      [&] { program.reset(); });
+
+  program.reset();
+  std::size_t before = allocationCount();
+  {
+    Lexer l{source};
+    Parser p{&l};
+    program = p.parseProgram();
+  }
+  std::size_t allocations = allocationCount() - before;
+  result.nodes = countNodes(program.get());
+  result.allocationsPerNode = double(allocations) / result.nodes;
+  program.reset();
+
+  ParseResult parsed{};
+  result.arenaParserSeconds = fastestRun(
+      minSeconds,
+      [&] {
+        Lexer l{source};
+        Parser p{&l};
+        parsed = p.parseProgramInArena();
+      },
+      [&] { parsed = ParseResult{}; });
+
+  parsed = ParseResult{};
+  before = allocationCount();
+  {
+    Lexer l{source};
+    Parser p{&l};
+    parsed = p.parseProgramInArena();
+  }
+  allocations = allocationCount() - before;
+  result.arenaAllocationsPerNode = double(allocations) / result.nodes;
+  return result;
+}
+
+double megabytesPerSecond(std::size_t bytes, double seconds) {
+  return bytes / (1024.0 * 1024.0) / seconds;
+}
+
+void printText(const std::vector<CorpusResult> &results) {
+  std::printf("%-7s %10s %9s %9s %11s %13s %13s %11s %13s %11s %10s "
+              "%12s\n",
+              "corpus", "bytes", "tokens", "nodes", "lexer MB/s", "tokens/s",
+              "tokenize MB/s", "parser MB/s", "nodes/s", "allocs/node",
+              "arena MB/s", "arena allocs");
+  for (auto &&r : results) {
+    std::printf("%-7s %10zu %9zu %9zu %11.2f %13.0f %13.2f %11.2f %13.0f "
+                "%11.2f %10.2f %12.2f\n",
+                r.name.c_str(), r.bytes, r.tokens, r.nodes,
+                megabytesPerSecond(r.bytes, r.lexerSeconds),
+                r.tokens / r.lexerSeconds,
+                megabytesPerSecond(r.bytes, r.tokenizeSeconds),
+                megabytesPerSecond(r.bytes, r.parserSeconds),
+                r.nodes / r.parserSeconds, r.allocationsPerNode,
+                megabytesPerSecond(r.bytes, r.arenaParserSeconds),
+                r.arenaAllocationsPerNode);
+  }
+}
+
+void printJson(const std::vector<CorpusResult> &results) {
+  std::printf("{\n  \"format\": 1,\n  \"corpora\": [\n");
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const CorpusResult &r = results[i];
+    std::printf("    {\"name\": \"%s\", \"bytes\": %zu, "
+                "\"hash\": \"%016llx\", \"tokens\": %zu, \"nodes\": %zu,\n",
+                r.name.c_str(), r.bytes,
+                static_cast<unsigned long long>(r.hash), r.tokens, r.nodes);
+    std::printf("     \"lexer_mb_per_s\": %.2f, \"lexer_tokens_per_s\": %.0f, "
+                "\"tokenize_mb_per_s\": %.2f,\n",
+                megabytesPerSecond(r.bytes, r.lexerSeconds),
+                r.tokens / r.lexerSeconds,
+                megabytesPerSecond(r.bytes, r.tokenizeSeconds));
+    std::printf("     \"parser_mb_per_s\": %.2f, \"parser_nodes_per_s\": %.0f, "
+                "\"allocations_per_node\": %.3f,\n",
+                megabytesPerSecond(r.bytes, r.parserSeconds),
+                r.nodes / r.parserSeconds, r.allocationsPerNode);
+    std::printf("     \"arena_parser_mb_per_s\": %.2f, "
+                "\"arena_allocations_per_node\": %.3f}%s\n",
+                megabytesPerSecond(r.bytes, r.arenaParserSeconds),
+                r.arenaAllocationsPerNode, i + 1 < results.size() ? "," : "");
+  }
+  std::printf("  ]\n}\n");
+}
+
+// The Pratt parser's dispatch on expression-dense input: once as one
+// program, once with a new Parser per line as the REPL does, where setting
+// up the parser is a large part of the work.
+void benchExpressions(std::size_t lines, int iterations) {
+  std::string source = generateExpressionProgram(lines);
+  std::size_t nodes = 0;
+  {
+    Lexer l{source};
+    Parser p{&l};
+    nodes = countNodes(p.parseProgram().get()) * iterations;
+  }
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    Lexer l{source};
+    Parser p{&l};
+    p.parseProgram();
+  }
+  double seconds = secondsSince(start);
+  double megabytes = double(source.size()) * iterations / (1024.0 * 1024.0);
+  std::printf("parser (expressions): %10.2f MB/s  %12.0f nodes/s\n",
+              megabytes / seconds, nodes / seconds);
+
+  std::vector<std::string_view> split{};
+  std::string_view rest{source};
+  while (!rest.empty()) {
+    std::size_t newline = rest.find('\n');
+    split.push_back(rest.substr(0, newline));
+    rest.remove_prefix(newline + 1);
+  }
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (auto &&line : split) {
+      Lexer l{line};
+      Parser p{&l};
+      p.parseProgram();
+    }
+  }
+  seconds = secondsSince(start);
+  std::printf("parser per line (expressions): %10.2f MB/s  %12.0f lines/s\n",
+              megabytes / seconds, split.size() * iterations / seconds);
+}
+
+// Benchmarks of single features (interning, parallel and incremental
+// lexing, the token cache, ...) on a generateProgram corpus.
+void benchFeatures(std::size_t functions, int iterations) {
+  std::string source = generateProgram(functions);
+  std::printf("corpus: %zu bytes, %d iterations\n", source.size(), iterations);
+
+  benchLexer("mixed", source, iterations);
+  benchLexer<TerminatedLexer>("mixed, terminated", source, iterations);
+  benchLexer("indented", generateIndentedProgram(functions), iterations);
+  benchLexer("commented", generateCommentedProgram(functions), iterations);
+  benchLexer("utf-8", generateUnicodeProgram(functions), iterations);
+  benchLexer("decimal", generateDecimalProgram(functions), iterations);
+  benchInterningLexer(source, iterations);
+  benchTokenize(source, iterations);
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  benchParallelTokenize("mixed", source, iterations);
+  // Whitespace inside strings is where a careless cut would land
+  benchParallelTokenize("strings", generateStringProgram(functions),
+                        iterations);
+  benchStreamLexer(source, iterations);
+  benchRelex(source);
+  benchSourceFile(source, iterations);
+  benchTokenCache(source, iterations);
+  benchParser(source, iterations);
+  benchExpressions(functions, iterations);
+  benchKeywords(source, iterations);
+}
+
+// monkey_bench [--json] [--min-time SECONDS]
+//   throughput on the standard small, medium and huge corpora
+// monkey_bench --features [FUNCTIONS [ITERATIONS]]
+//   the feature benchmarks
+int main(int argc, char *argv[]) {
+  bool json = false;
+  double minSeconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{argv[i]};
+    if (arg == "--features") {
+      std::size_t functions =
+          i + 1 < argc ? std::strtoul(argv[i + 1], nullptr, 10) : 20000;
+      int iterations = i + 2 < argc ? std::atoi(argv[i + 2]) : 5;
+      benchFeatures(functions, iterations);
+      return 0;
+    } else if (arg == "--json") {
+      json = true;
+    } else if (arg == "--min-time" && i + 1 < argc) {
+      minSeconds = std::atof(argv[++i]);
+    } else {
+      std::fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::vector<CorpusResult> results{};
+  for (auto &&corpus : standardCorpora()) {
+    results.push_back(benchCorpus(corpus, minSeconds));
+  }
+  if (json) {
+    printJson(results);
+  } else {
+    printText(results);
+  }
+}
@@ -0,0 +1,130 @@
+#include "corpus.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace {
+
+void appendFunction(std::string &program, std::size_t i) {
+  std::string n = std::to_string(i);
+  program += "let compute_" + n + " = fn(alpha, beta) {\n";
+  program += "  if (alpha < beta) { return alpha + beta * " + n + "; }\n";
+  program += "  else { return !(alpha == beta) - beta / 3; }\n";
+  program += "};\n";
+  program += "let result_" + n + " = compute_" + n + "(" + n + ", 42) > " +
+             n + " != false;\n";
+}
+
+void appendIndentedFunction(std::string &program, std::size_t i) {
+  std::string indent(24, ' ');
+  std::string name = "generated_rule_function_" + std::to_string(i);
+  program += "let " + name + " = fn(first_argument_value, second_value) {\n";
+  program += indent + "if (first_argument_value < second_value) {\n";
+  program += indent + indent + "return first_argument_value + 1234567890;\n";
+  program += indent + "}\n" + indent + "return second_value;\n};\n";
+}
+
+void appendCommentedFunction(std::string &program, std::size_t i) {
+  std::string n = std::to_string(i);
+  program += "/*\n * Generated from rules/compute_" + n + ".yaml\n";
+  program += " * Do not edit: changes are overwritten on the next run.\n";
+  program += " * Inputs: alpha (left operand), beta (right operand)\n */\n";
+  program += "let compute_" + n + " = fn(alpha, beta) {\n";
+  program += "  if (alpha < beta) { return alpha + beta * " + n + "; }\n";
+  program += "  else { return !(alpha == beta) - beta / 3; }\n";
+  program += "}; // end of compute_" + n + ", keep in sync with the rules\n";
+}
+
+void appendUnicodeFunction(std::string &program, std::size_t i) {
+  std::string n = std::to_string(i);
+  program += "let berechne_" + n + " = fn(größe, λ) {\n";
+  program += "  if (größe < λ) { return größe + λ * " + n + "; }\n";
+  program += "  else { return !(größe == λ) - 数据 / 3; }\n";
+  program += "};\n";
+  program +=
+      "let ergebnis_" + n + " = berechne_" + n + "(\"übergröße\", 42);\n";
+}
+
+void appendStringFunction(std::string &program, std::size_t i) {
+  std::string n = std::to_string(i);
+  program += "let greet_" + n + " = fn(name) {\n";
+  program += "  return \"Hello, \" + name + \"! You are visitor number " + n +
+             " of the day.\";\n";
+  program += "};\n";
+  program += "let usage_" + n +
+             " = \"usage: greet <name> [--loud] prints a greeting and the "
+             "visitor count\";\n";
+}
+
+void appendDecimalRow(std::string &program, std::size_t i) {
+  std::string n = std::to_string(i);
+  std::string fraction = std::to_string(i * 7919 % 100000);
+  program += "let sample_" + n + " = " + n + "." + fraction + " * 0.0625 + ";
+  program += "3.14159265358979e-" + std::to_string(i % 300);
+  program += " - 6.02214076e+23 / " + fraction + ".5;\n";
+}
+
+void appendExpressionLine(std::string &program, std::size_t i) {
+  std::string n = std::to_string(i % 1000);
+  program += "a * " + n + " + -b / (c - " + n + ") < d == !(e > f) != g(" +
+             n + ", h * i + j) - k;\n";
+}
+
+using Appender = void (*)(std::string &, std::size_t);
+
+std::string generate(std::size_t functions, Appender append) {
+  std::string program{};
+  for (std::size_t i = 0; i < functions; ++i) {
+    append(program, i);
+  }
+  return program;
+}
+
+} // namespace
+
+std::string generateProgram(std::size_t functions) {
+  return generate(functions, appendFunction);
+}
+
+std::string generateIndentedProgram(std::size_t functions) {
+  return generate(functions, appendIndentedFunction);
+}
+
+std::string generateCommentedProgram(std::size_t functions) {
+  return generate(functions, appendCommentedFunction);
+}
+
+std::string generateUnicodeProgram(std::size_t functions) {
+  return generate(functions, appendUnicodeFunction);
+}
+
+std::string generateStringProgram(std::size_t functions) {
+  return generate(functions, appendStringFunction);
+}
+
+std::string generateDecimalProgram(std::size_t functions) {
+  return generate(functions, appendDecimalRow);
+}
+
+std::string generateExpressionProgram(std::size_t lines) {
+  return generate(lines, appendExpressionLine);
+}
+
+std::string generateMixedProgram(std::size_t functions) {
+  constexpr Appender shapes[] = {appendFunction, appendIndentedFunction,
+                                 appendCommentedFunction,
+                                 appendUnicodeFunction};
+  std::string program{};
+  for (std::size_t i = 0; i < functions; ++i) {
+    shapes[i % 4](program, i);
+  }
+  return program;
+}
+
+std::vector<Corpus> standardCorpora() {
+  return {
+      {"small", generateMixedProgram(16)},
+      {"medium", generateMixedProgram(4000)},
+      {"huge", generateMixedProgram(64000)},
+  };
+}
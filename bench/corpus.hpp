@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Synthetic Monkey programs for the benchmarks. They are generated rather
+// than shipped, and the generators are deterministic, so every build
+// measures exactly the same bytes; the JSON report includes a hash of each
+// corpus to make that checkable.
+
+// `functions` small function definitions and calls, exercising every
+// operator and keyword.
+std::string generateProgram(std::size_t functions);
+
+// Deep indentation and long identifiers, the layout of machine generated
+// scripts.
+std::string generateIndentedProgram(std::size_t functions);
+
+// generateProgram with a provenance block comment before every function and
+// a line comment after it.
+std::string generateCommentedProgram(std::size_t functions);
+
+// generateProgram with non-ASCII identifiers and strings.
+std::string generateUnicodeProgram(std::size_t functions);
+
+// Functions whose bodies are mostly string literals full of spaces. Not part
+// of the mixed program.
+std::string generateStringProgram(std::size_t functions);
+
+// Arithmetic on float literals with fractions and exponents, the shape of a
+// numeric data file. Not part of the mixed program.
+std::string generateDecimalProgram(std::size_t functions);
+
+// One line of operators, literals, calls and parentheses per line, where
+// nearly every token goes through the Pratt parser's dispatch.
+std::string generateExpressionProgram(std::size_t lines);
+
+// The four shapes above interleaved, one function at a time.
+std::string generateMixedProgram(std::size_t functions);
+
+struct Corpus {
+  std::string name;
+  std::string source;
+};
+
+// small (a few KB, a typical REPL paste or config script), medium (about
+// 1 MB) and huge (about 16 MB) mixed programs.
+std::vector<Corpus> standardCorpora();
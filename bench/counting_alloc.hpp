@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+
+// Linking counting_alloc.cpp into a program replaces every form of the global
+// operator new and delete with malloc and free, and counts the allocations,
+// so a benchmark or test can check how often some code allocates.
+
+// Number of operator new calls so far, in all threads.
+std::size_t allocationCount();
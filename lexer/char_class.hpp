@@ -0,0 +1,103 @@
+#pragma once
+#include "../token/token.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Lookup tables that drive Lexer::nextToken. Adding a punctuation token or a
+// two charachter operator means adding a row to one of the lists below; the
+// 256 entry tables are generated from them at compile time.
+
+struct SingleCharToken {
+  char ch;
+  TokenKind kind;
+};
+
+constexpr SingleCharToken singleCharTokens[] = {
+    {'=', TokenKind::ASSIGN},
+    {'+', TokenKind::PLUS},
+    {'-', TokenKind::MINUS},
+    {'!', TokenKind::BANG},
+    {'*', TokenKind::ASTERISK},
+    {'/', TokenKind::SLASH},
+    {'<', TokenKind::LT},
+    {'>', TokenKind::GT},
+    {',', TokenKind::COMMA},
+    {';', TokenKind::SEMICOLON},
+    {'(', TokenKind::LPAREN},
+    {')', TokenKind::RPAREN},
+    {'{', TokenKind::LBRACE},
+    {'}', TokenKind::RBRACE},
+};
+
+struct TwoCharToken {
+  char first;
+  char second;
+  TokenKind kind;
+};
+
+// Checked before singleCharTokens, so "==" wins over "=" "=".
+constexpr TwoCharToken twoCharTokens[] = {
+    {'=', '=', TokenKind::EQ},
+    {'!', '=', TokenKind::NOT_EQ},
+};
+
+enum class CharClass : std::uint8_t {
+  ILLEGAL,
+  END, // NUL, which the lexer also reads past the end of the input
+  WHITESPACE,
+  LETTER,
+  DIGIT,
+  PUNCT,      // a single charachter token
+  PUNCT_PAIR, // may also start a two charachter token
+  QUOTE,      // starts a string literal
+  NON_ASCII,  // a byte >= 0x80, part of a UTF-8 sequence
+};
+
+constexpr std::array<CharClass, 256> buildCharClasses() {
+  std::array<CharClass, 256> classes{};
+  classes[0] = CharClass::END;
+  for (unsigned char c : {' ', '\t', '\n', '\r'}) {
+    classes[c] = CharClass::WHITESPACE;
+  }
+  for (int c = 'a'; c <= 'z'; ++c) {
+    classes[c] = CharClass::LETTER;
+    classes[c - 'a' + 'A'] = CharClass::LETTER;
+  }
+  classes['_'] = CharClass::LETTER;
+  classes['"'] = CharClass::QUOTE;
+  for (int c = 0x80; c <= 0xFF; ++c) {
+    classes[c] = CharClass::NON_ASCII;
+  }
+  for (int c = '0'; c <= '9'; ++c) {
+    classes[c] = CharClass::DIGIT;
+  }
+  for (auto &&token : singleCharTokens) {
+    classes[static_cast<unsigned char>(token.ch)] = CharClass::PUNCT;
+  }
+  for (auto &&token : twoCharTokens) {
+    classes[static_cast<unsigned char>(token.first)] = CharClass::PUNCT_PAIR;
+  }
+  return classes;
+}
+
+constexpr std::array<CharClass, 256> charClasses = buildCharClasses();
+
+// Kind of the single charachter token starting with each byte, ILLEGAL if
+// there is none.
+constexpr std::array<TokenKind, 256> buildSingleCharKinds() {
+  std::array<TokenKind, 256> kinds{};
+  for (auto &kind : kinds) {
+    kind = TokenKind::ILLEGAL;
+  }
+  for (auto &&token : singleCharTokens) {
+    kinds[static_cast<unsigned char>(token.ch)] = token.kind;
+  }
+  return kinds;
+}
+
+constexpr std::array<TokenKind, 256> singleCharKinds = buildSingleCharKinds();
+
+constexpr CharClass charClass(char ch) {
+  return charClasses[static_cast<unsigned char>(ch)];
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Writes xid_ranges.hpp: the non-ASCII code points with the Unicode
+XID_Start and XID_Continue properties, as sorted ranges.
+
+Python's own identifiers are defined by the same two properties, so
+str.isidentifier() reads them from the interpreter's Unicode database. Run it
+with the Python whose Unicode version the lexer should follow:
+
+    python3 lexer/gen_xid_ranges.py > lexer/xid_ranges.hpp
+"""
+
+import unicodedata
+
+
+def ranges(has_property):
+    found = []
+    start = None
+    for code_point in range(0x80, 0x110000):
+        inside = not 0xD800 <= code_point <= 0xDFFF and has_property(
+            chr(code_point))
+        if inside and start is None:
+            start = code_point
+        elif not inside and start is not None:
+            found.append((start, code_point - 1))
+            start = None
+    if start is not None:
+        found.append((start, 0x10FFFF))
+    return found
+
+
+def table(name, comment, found):
+    cells = ["{0x%04X, 0x%04X}," % r for r in found]
+    width = max(len(cell) for cell in cells) + 1
+    lines = [comment, "inline constexpr CodePointRange %s[] = {" % name]
+    for i in range(0, len(cells), 3):
+        row = "".join(cell.ljust(width) for cell in cells[i:i + 3])
+        lines.append("    " + row.rstrip())
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    start = ranges(lambda c: c.isidentifier())
+    cont = ranges(lambda c: ("a" + c).isidentifier())
+    print("// Generated by gen_xid_ranges.py from Unicode %s; do not edit."
+          % unicodedata.unidata_version)
+    print("#pragma once")
+    print()
+    print("struct CodePointRange {")
+    print("  char32_t first;")
+    print("  char32_t last;")
+    print("};")
+    print()
+    print(table("xidStartRanges",
+                "// Non-ASCII code points that may start an identifier.",
+                start))
+    print()
+    print(table("xidContinueRanges",
+                "// Non-ASCII code points that may follow the first one: the "
+                "above plus\n// combining marks, digits and connectors.",
+                cont))
+
+
+if __name__ == "__main__":
+    main()
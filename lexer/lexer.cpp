@@ -1,134 +1,220 @@
 #include "lexer.hpp"
 #include "../token/token.hpp"
-#include <cctype>
+#include "char_class.hpp"
+#include "utf8.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
-#include <string>
+#include <cstring>
+#include <string_view>
 
-void Lexer::readChar() {
-  if (readPosition >= input.size()) {
-    ch = 0;
-  } else {
-    ch = input[readPosition];
-  }
+template <typename Input> void BasicLexer<Input>::readChar() {
+  ch = Input::charAt(input, readPosition);
   position = readPosition;
-  readPosition++;
+  // Stay on the end of the input once it is reached so that views taken at
+  // EOF never point past the buffer.
+  if (!Input::atEnd(input, readPosition, ch)) {
+    readPosition++;
+  }
 };
 
-Token Lexer::nextToken() {
-  Token token{};
+template <typename Input>
+std::string_view BasicLexer<Input>::currentChar() {
+  return input.substr(position, 1);
+}
+
+template <typename Input> void BasicLexer<Input>::jumpTo(std::size_t pos) {
+  readPosition = pos;
+  readChar();
+}
 
+template <typename Input> Token BasicLexer<Input>::nextToken() {
   skipWhitespace();
 
-  switch (ch) {
-  case ';':
-    token = Token(TokenTypes::SEMICOLON, ch);
-    break;
-  case '(':
-    token = Token(TokenTypes::LPAREN, ch);
-    break;
-  case ')':
-    token = Token(TokenTypes::RPAREN, ch);
-    break;
-  case ',':
-    token = Token(TokenTypes::COMMA, ch);
-    break;
-  case '+':
-    token = Token(TokenTypes::PLUS, ch);
-    break;
-  case '{':
-    token = Token(TokenTypes::LBRACE, ch);
-    break;
-  case '}':
-    token = Token(TokenTypes::RBRACE, ch);
-    break;
-  case '-':
-    token = Token(TokenTypes::MINUS, ch);
-    break;
-  case '*':
-    token = Token(TokenTypes::ASTERISK, ch);
-    break;
-  case '/':
-    token = Token(TokenTypes::SLASH, ch);
-    break;
-  case '<':
-    token = Token(TokenTypes::LT, ch);
-    break;
-  case '>':
-    token = Token(TokenTypes::GT, ch);
-    break;
-  case '=':
-    if (peekChar() == '=') {
-      readChar();
-      token.Type = TokenTypes::EQ;
-      token.Literal = "==";
-    } else {
-      token = Token(TokenTypes::ASSIGN, ch);
+  Token token{};
+  token.Offset = static_cast<std::uint32_t>(position);
+  switch (charClass(ch)) {
+  case CharClass::NON_ASCII:
+    if (identifierStartLength(input, position) == 0) {
+      readIllegalSequence(token);
+      return token;
     }
-    break;
-  case '!':
-    if (peekChar() == '=') {
-      readChar();
-      token.Type = TokenTypes::NOT_EQ;
-      token.Literal = "!=";
-    } else {
-      token = Token(TokenTypes::BANG, ch);
+    [[fallthrough]];
+  case CharClass::LETTER:
+    token.Literal = readIdentifier();
+    token.setIdentifier(token.Literal);
+    if (symbols != nullptr && token.Type == TokenKind::IDENT) {
+      token.Symbol = symbols->intern(token.Literal);
+    }
+    return token;
+  case CharClass::DIGIT:
+    readNumber(token);
+    return token;
+  case CharClass::QUOTE:
+    readString(token);
+    return token;
+  case CharClass::END:
+    token.Type = TokenKind::EOF_;
+    token.Literal = input.substr(position, 0);
+    return token;
+  case CharClass::PUNCT_PAIR: {
+    char next = peekChar();
+    for (auto &&pair : twoCharTokens) {
+      if (pair.first == ch && pair.second == next) {
+        token.Type = pair.kind;
+        token.Literal = input.substr(position, 2);
+        jumpTo(position + 2);
+        return token;
+      }
     }
     break;
-  case 0:
-    token.Type = TokenTypes::EOF_;
-    token.Literal = "";
-    break;
+  }
   default:
-    if (isLetter(ch)) {
-      token.Literal = readIdentifier();
-      token.setIdentifier(token.Literal);
-      return token;
-    } else if (isDigit(ch)) {
-      token.Type = TokenTypes::INT;
-      token.Literal = readNumber();
-      return token;
-    } else {
-
-      token = Token(TokenTypes::ILLEGAL, ch);
-    }
+    break;
   }
+
+  // Single charachter tokens; anything without a table entry is ILLEGAL
+  token.Type = singleCharKinds[static_cast<unsigned char>(ch)];
+  token.Literal = currentChar();
   readChar();
   return token;
 }
 
-std::string Lexer::readIdentifier() {
-  int pos{position};
-  while (isLetter(ch)) {
-    readChar();
+template <typename Input> std::string_view BasicLexer<Input>::readIdentifier() {
+  std::size_t pos{position};
+  std::size_t end = kernels->identifier(input, position);
+  // The vector kernel only knows ASCII. UTF-8 is decoded only when it stops
+  // on a byte >= 0x80, so ASCII identifiers pay a single extra compare.
+  while (end < input.size() && charClass(input[end]) == CharClass::NON_ASCII) {
+    std::size_t length = identifierContinueLength(input, end);
+    if (length == 0) {
+      break;
+    }
+    end = kernels->identifier(input, end + length);
   }
-  std::string identifier = input.substr(pos, position - pos);
-  return identifier;
+  jumpTo(end);
+  return input.substr(pos, position - pos);
 }
 
-void Lexer::skipWhitespace() {
-  while (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
-    readChar();
+template <typename Input>
+void BasicLexer<Input>::readIllegalSequence(Token &token) {
+  std::size_t length = decodeUtf8(input, position).length;
+  if (length == 0) {
+    length = 1;
   }
+  token.Type = TokenKind::ILLEGAL;
+  token.Literal = input.substr(position, length);
+  jumpTo(position + length);
 }
 
-std::string Lexer::readNumber() {
-  int pos{position};
-  while (isDigit(ch)) {
-    readChar();
+template <typename Input> void BasicLexer<Input>::readString(Token &token) {
+  const char *data = input.data();
+  std::size_t start = position;
+  std::size_t pos = position + 1;
+  bool escaped = false;
+  while (true) {
+    // Find the next quote, then check whether a backslash comes before it;
+    // strings without escapes are two memchr calls.
+    const char *quote = static_cast<const char *>(
+        std::memchr(data + pos, '"', input.size() - pos));
+    std::size_t end = quote != nullptr ? quote - data : input.size();
+    const char *slash =
+        static_cast<const char *>(std::memchr(data + pos, '\\', end - pos));
+    if (slash == nullptr) {
+      if (quote == nullptr) {
+        // Unterminated: the rest of the input is one ILLEGAL token
+        token.Type = TokenKind::ILLEGAL;
+        token.Literal = input.substr(start);
+        jumpTo(input.size());
+        return;
+      }
+      token.Type = TokenKind::STRING;
+      token.HasEscapes = escaped;
+      token.Literal = input.substr(start, end + 1 - start);
+      jumpTo(end + 1);
+      return;
+    }
+    // Skip the backslash and the charachter it escapes
+    escaped = true;
+    pos = std::min<std::size_t>(slash - data + 2, input.size());
   }
-  return input.substr(pos, position - pos);
 }
 
-char Lexer::peekChar() {
-  if (readPosition >= input.size()) {
-    return 0;
+template <typename Input> void BasicLexer<Input>::skipWhitespace() {
+  while (true) {
+    // Most tokens are separated by a single space, which is not worth a call
+    // into the vector kernel.
+    if (isWhitespace(ch)) {
+      readChar();
+      if (isWhitespace(ch)) {
+        jumpTo(kernels->whitespace(input, position));
+      }
+    }
+    if (ch != '/' || !skipComment()) {
+      return;
+    }
+  }
+}
+
+template <typename Input> bool BasicLexer<Input>::skipComment() {
+  // Both searches are memchr based, so comment text is skipped at the same
+  // speed as a run of whitespace instead of one readChar() per byte.
+  char next = peekChar();
+  if (next == '/') {
+    std::size_t from = position + 2;
+    const char *newline = static_cast<const char *>(
+        std::memchr(input.data() + from, '\n', input.size() - from));
+    jumpTo(newline != nullptr ? newline - input.data() + 1 : input.size());
+    return true;
+  }
+  if (next == '*') {
+    std::size_t close = input.find("*/", position + 2);
+    jumpTo(close != std::string_view::npos ? close + 2 : input.size());
+    return true;
+  }
+  return false;
+}
+
+template <typename Input> void BasicLexer<Input>::readNumber(Token &token) {
+  std::size_t start{position};
+  std::size_t end = kernels->digits(input, position);
+  bool fractional = false;
+  if (end + 1 < input.size() && input[end] == '.' && isDigit(input[end + 1])) {
+    end = kernels->digits(input, end + 1);
+    fractional = true;
+  }
+  if (end < input.size() && (input[end] == 'e' || input[end] == 'E')) {
+    std::size_t exponent = end + 1;
+    if (exponent < input.size() &&
+        (input[exponent] == '+' || input[exponent] == '-')) {
+      ++exponent;
+    }
+    if (exponent < input.size() && isDigit(input[exponent])) {
+      end = kernels->digits(input, exponent);
+      fractional = true;
+    }
+  }
+  jumpTo(end);
+  token.Literal = input.substr(start, end - start);
+  if (fractional) {
+    token.Type = TokenKind::FLOAT;
+    token.FloatValue = floatLiteralValue(token.Literal);
   } else {
-    return input[readPosition];
+    token.Type = TokenKind::INT;
+    token.Value = integerLiteralValue(token.Literal);
   }
 }
 
-bool isLetter(char ch) {
-  return 'a' <= ch && ch <= 'z' || 'A' <= ch && ch <= 'Z' || ch == '_';
+template <typename Input> char BasicLexer<Input>::peekChar() {
+  return Input::charAt(input, readPosition);
 }
 
-bool isDigit(char ch) { return ('0' <= ch && ch <= '9'); }
+template class BasicLexer<ViewInput>;
+template class BasicLexer<TerminatedInput>;
+
+bool isLetter(char ch) { return charClass(ch) == CharClass::LETTER; }
+
+bool isDigit(char ch) { return charClass(ch) == CharClass::DIGIT; }
+
+bool isWhitespace(char ch) { return charClass(ch) == CharClass::WHITESPACE; }
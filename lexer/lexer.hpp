@@ -1,43 +1,135 @@
 #pragma once
+#include "../token/interner.hpp"
 #include "../token/token.hpp"
-#include <string>
+#include "scan.hpp"
+#include "token_source.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
 
-class Lexer {
+// How many bytes past the end of a token the lexer may read to decide where
+// the token ends: one for "==" and "!=", up to three for a number followed by
+// "e+" and up to four to decode a UTF-8 sequence after an identifier.
+// Relexing and the StreamLexer rely on it.
+constexpr std::size_t maxLookahead = 4;
+
+// Input policies decide how BasicLexer reads the byte at a position. They are
+// template arguments, so the choice costs nothing per charachter.
+
+// Any contiguous view, such as a std::string_view or a mapped SourceFile.
+// Every read is bounds checked and reads past the end give NUL.
+struct ViewInput {
+  static char charAt(std::string_view input, std::size_t pos) {
+    return pos < input.size() ? input[pos] : 0;
+  }
+  static bool atEnd(std::string_view input, std::size_t pos, char) {
+    return pos >= input.size();
+  }
+};
+
+// A view whose buffer has a NUL right after its last byte, like the buffer of
+// a std::string. Reading that NUL takes the place of the bounds check. A NUL
+// inside the input ends it, as it does for ViewInput.
+struct TerminatedInput {
+  static char charAt(std::string_view input, std::size_t pos) {
+    return input.data()[pos];
+  }
+  static bool atEnd(std::string_view, std::size_t, char ch) { return ch == 0; }
+};
+
+// The Lexer borrows its input instead of copying it. Every Token::Literal it
+// returns is a slice of `in`, so the caller must keep the source buffer alive
+// for as long as the tokens (or any AST built from them) are in use.
+//
+// The member functions are defined in lexer.cpp and instantiated there for
+// ViewInput and TerminatedInput.
+template <typename Input> class BasicLexer : public TokenSource {
 
 private:
-  std::string input;
-  int position;
-  int readPosition;
+  std::string_view input;
+  std::size_t position;
+  std::size_t readPosition;
   char ch;
+  const ScanKernels *kernels;
+  Interner *symbols;
+
+  // Returns the single charachter under position as a view into the input.
+  std::string_view currentChar();
+
+  // Moves the lexer so that ch is the charachter at pos.
+  void jumpTo(std::size_t pos);
 
 public:
-  Lexer(std::string in) : input{in}, position{}, readPosition{}, ch{} {
+  // Starts lexing at byte offset start; literals still slice the whole input.
+  // Token::Offset is 32 bits, so inputs of 4 GiB or more throw
+  // std::length_error.
+  BasicLexer(std::string_view in, std::size_t start = 0)
+      : input{in}, position{}, readPosition{start}, ch{},
+        kernels{&scanKernels()}, symbols{nullptr} {
+    if (input.size() > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("Lexer: source larger than 4 GiB");
+    }
     readChar();
   };
 
+  // Also interns every identifier into s and sets Token::Symbol.
+  BasicLexer(std::string_view in, Interner &s, std::size_t start = 0)
+      : BasicLexer(in, start) {
+    symbols = &s;
+  };
+
   // Advance the position and give us the next charachter
   void readChar();
 
   // Reads the ch and returns the corresponding token
-  Token nextToken();
+  Token nextToken() override;
+
+  // Reads the current identifier and returns a view of it in the input.
+  // Identifiers start with an ASCII letter, '_' or a non-ASCII XID_Start
+  // charachter, followed by those, digits and XID_Continue charachters.
+  std::string_view readIdentifier();
+
+  // Reads a non-ASCII charachter that cannot start an identifier, or a
+  // malformed UTF-8 byte, as an ILLEGAL token.
+  void readIllegalSequence(Token &token);
 
-  // Reads the current identifier and returns the identifier as a string.
-  std::string readIdentifier();
+  // Reads a string literal starting at the opening quote into token: STRING
+  // with the quotes included in its Literal, or ILLEGAL if it is never closed.
+  void readString(Token &token);
 
   // Function to skip over whitespace because we do not consider it useful.
+  // Comments count as whitespace.
   void skipWhitespace();
 
-  // Reads the current number fully and returns the number using the isDigit
-  // function
-  std::string readNumber();
+  // Skips a "//" comment up to and including its newline, or a "/* */"
+  // comment, if one starts at ch. A block comment that is never closed runs
+  // to the end of the input.
+  bool skipComment();
+
+  // Reads the number starting at ch into token: INT for a run of digits,
+  // FLOAT if a '.' and more digits, an exponent ("e", an optional sign and
+  // digits) or both follow. A '.' or 'e' without digits after it is not part
+  // of the number.
+  void readNumber(Token &token);
 
   // Gets the next charachter in the lexer without moving the position forward
   char peekChar();
 };
 
+using Lexer = BasicLexer<ViewInput>;
+using TerminatedLexer = BasicLexer<TerminatedInput>;
+
+extern template class BasicLexer<ViewInput>;
+extern template class BasicLexer<TerminatedInput>;
+
 // Helper Functions
 // The function defines all the allowed charachters in an identifier.
 bool isLetter(char ch);
 
 // Function to check for integers and numbers
 bool isDigit(char ch);
+
+// Whitespace separates tokens and is otherwise ignored.
+bool isWhitespace(char ch);
@@ -0,0 +1,37 @@
+#include "line_table.hpp"
+#include "scan.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+LineTable::LineTable(std::string_view src) : LineTable(src, scanKernels()) {}
+
+LineTable::LineTable(std::string_view src, const ScanKernels &k)
+    : source{src}, lineStarts{}, kernels{&k}, built{false} {}
+
+void LineTable::build() {
+  lineStarts.push_back(0);
+  kernels->lineStarts(source, lineStarts);
+  built = true;
+}
+
+SourceLocation LineTable::locate(std::uint32_t offset) {
+  if (!built) {
+    build();
+  }
+  offset = std::min<std::uint32_t>(offset, source.size());
+  // The last line start at or before offset
+  auto line = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+  --line;
+  return SourceLocation{
+      static_cast<std::uint32_t>(line - lineStarts.begin() + 1),
+      offset - *line + 1};
+}
+
+std::size_t LineTable::lineCount() {
+  if (!built) {
+    build();
+  }
+  return lineStarts.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "scan.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// 1-based line and column of a byte offset. Columns count bytes.
+struct SourceLocation {
+  std::uint32_t line;
+  std::uint32_t column;
+};
+
+// Turns the byte offsets stored in tokens back into line and column. Tokens
+// only carry an offset, so nothing is spent on line bookkeeping while lexing;
+// the table of line starts is built by one newline scan the first time a
+// location is asked for, which usually means only when an error is printed.
+class LineTable {
+private:
+  std::string_view source;
+  std::vector<std::uint32_t> lineStarts;
+  const ScanKernels *kernels;
+  bool built;
+
+  void build();
+
+public:
+  explicit LineTable(std::string_view src);
+  // Use specific scan kernels, e.g. to test one SIMD level against another.
+  LineTable(std::string_view src, const ScanKernels &k);
+
+  // Offsets past the end of the source are located at its end.
+  SourceLocation locate(std::uint32_t offset);
+  std::size_t lineCount();
+};
@@ -0,0 +1,215 @@
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include "token_buffer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Below this many bytes per thread the threads cost more than they save
+constexpr std::size_t minimumChunkSize = 64 * 1024;
+
+std::uint32_t offsetOf(std::string_view source, const Token &token) {
+  return static_cast<std::uint32_t>(token.Literal.data() - source.data());
+}
+
+// How far around a cut chunkBoundaries looks for a line start and a newline
+constexpr std::size_t cutWindow = 4096;
+
+// The first newline at or after `at` that is outside strings and comments,
+// scanning from the first line starting in the window before it. Falls back
+// to the next whitespace when the window holds no such newline.
+std::size_t cutNear(std::string_view source, std::size_t at) {
+  std::size_t limit = std::min(source.size(), at + cutWindow);
+  std::size_t from = 0;
+  if (at > cutWindow) {
+    // Without a line start in the window there is nothing to scan from
+    std::size_t newline = source.substr(at - cutWindow, cutWindow).find('\n');
+    from = newline != std::string_view::npos ? at - cutWindow + newline + 1
+                                             : limit;
+  }
+  enum class State { CODE, STRING, LINE_COMMENT, BLOCK_COMMENT };
+  State state = State::CODE;
+  for (std::size_t i = from; i < limit; ++i) {
+    char ch = source[i];
+    char next = i + 1 < source.size() ? source[i + 1] : '\0';
+    switch (state) {
+    case State::CODE:
+      if (ch == '"') {
+        state = State::STRING;
+      } else if (ch == '/' && next == '/') {
+        state = State::LINE_COMMENT;
+        ++i;
+      } else if (ch == '/' && next == '*') {
+        state = State::BLOCK_COMMENT;
+        ++i;
+      } else if (ch == '\n' && i >= at) {
+        return i;
+      }
+      break;
+    case State::STRING:
+      if (ch == '\\') {
+        ++i;
+      } else if (ch == '"') {
+        state = State::CODE;
+      }
+      break;
+    case State::LINE_COMMENT:
+      if (ch == '\n') {
+        state = State::CODE;
+        if (i >= at) {
+          return i;
+        }
+      }
+      break;
+    case State::BLOCK_COMMENT:
+      if (ch == '*' && next == '/') {
+        state = State::CODE;
+        ++i;
+      }
+      break;
+    }
+  }
+
+  while (at < source.size() && !isWhitespace(source[at])) {
+    ++at;
+  }
+  return at;
+}
+
+// Lexes the tokens that start in [from, to). The last one may run past `to`.
+// Only the chunk ending at the end of the source gets the EOF token.
+TokenBuffer lexRange(std::string_view source, std::size_t from,
+                     std::size_t to) {
+  TokenBuffer tokens{};
+  tokens.source = source;
+  tokens.reserve((to - from) / 2 + 1);
+
+  Lexer l{source, from};
+  while (true) {
+    Token token = l.nextToken();
+    std::uint32_t start = offsetOf(source, token);
+    if (start >= to && to != source.size()) {
+      break;
+    }
+    tokens.push(token.Type, start,
+                static_cast<std::uint32_t>(token.Literal.size()));
+    if (token.Type == TokenKind::EOF_) {
+      break;
+    }
+  }
+  return tokens;
+}
+
+// tokenizeChunks without the bracket matching.
+TokenBuffer lexChunks(std::string_view source,
+                      const std::vector<std::size_t> &boundaries) {
+  if (source.size() > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("tokenize: source larger than 4 GiB");
+  }
+
+  std::size_t chunkCount = boundaries.size() - 1;
+  std::vector<TokenBuffer> chunks(chunkCount);
+  std::vector<std::thread> workers{};
+  for (std::size_t i = 1; i < chunkCount; ++i) {
+    workers.emplace_back([&, i] {
+      chunks[i] = lexRange(source, boundaries[i], boundaries[i + 1]);
+    });
+  }
+  chunks[0] = lexRange(source, boundaries[0], boundaries[1]);
+  for (auto &&worker : workers) {
+    worker.join();
+  }
+
+  // A chunk that started inside a token lexed garbage until it fell back
+  // into step. The lexer carries no state between tokens besides its
+  // position, so once a sequential lexer and a chunk produce a token at the
+  // same offset the rest of the chunk is exactly what tokenize would give.
+  // Usually that is the chunk's first token.
+  TokenBuffer result{};
+  result.source = source;
+
+  std::size_t resume = 0;
+  for (std::size_t c = 0; c < chunkCount; ++c) {
+    TokenBuffer &chunk = chunks[c];
+    std::size_t next = 0;
+    Lexer l{source, resume};
+    while (true) {
+      Token token = l.nextToken();
+      std::uint32_t start = offsetOf(source, token);
+      while (next < chunk.size() && chunk.start(next) < start) {
+        ++next;
+      }
+
+      if (next < chunk.size() && chunk.start(next) == start) {
+        if (result.size() == 0 && next == 0) {
+          result = std::move(chunk);
+        } else {
+          result.append(chunk, next);
+        }
+        resume = result.end(result.size() - 1);
+        break;
+      }
+      if (next == chunk.size() && start >= boundaries[c + 1] &&
+          token.Type != TokenKind::EOF_) {
+        // Nothing of this chunk is left, try to join the next one
+        break;
+      }
+
+      result.push(token.Type, start,
+                  static_cast<std::uint32_t>(token.Literal.size()));
+      resume = result.end(result.size() - 1);
+      if (token.Type == TokenKind::EOF_) {
+        return result;
+      }
+    }
+    if (result.size() != 0 &&
+        result.kind(result.size() - 1) == TokenKind::EOF_) {
+      return result;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TokenBuffer tokenizeChunks(std::string_view source,
+                           const std::vector<std::size_t> &boundaries) {
+  // Brackets can pair across chunks, so they are matched on the stitched
+  // stream rather than per chunk
+  TokenBuffer tokens = lexChunks(source, boundaries);
+  tokens.computeMatches();
+  return tokens;
+}
+
+TokenBuffer tokenizeParallel(std::string_view source, unsigned threads) {
+  // More threads than cores only adds stitching work
+  unsigned cores = std::thread::hardware_concurrency();
+  if (cores != 0) {
+    threads = std::min(threads, cores);
+  }
+  std::size_t chunkCount =
+      std::min<std::size_t>(threads, source.size() / minimumChunkSize);
+  if (chunkCount <= 1) {
+    return tokenize(source);
+  }
+  return tokenizeChunks(source, chunkBoundaries(source, chunkCount));
+}
+
+std::vector<std::size_t> chunkBoundaries(std::string_view source,
+                                         std::size_t chunks) {
+  std::vector<std::size_t> boundaries{0};
+  for (std::size_t i = 1; i < chunks; ++i) {
+    boundaries.push_back(std::max(cutNear(source, source.size() * i / chunks),
+                                  boundaries.back()));
+  }
+  boundaries.push_back(source.size());
+  return boundaries;
+}
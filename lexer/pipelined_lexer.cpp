@@ -0,0 +1,89 @@
+#include "pipelined_lexer.hpp"
+#include "../token/interner.hpp"
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+std::size_t roundUpToPowerOfTwo(std::size_t n) {
+  std::size_t power = 1;
+  while (power < n) {
+    power *= 2;
+  }
+  return power;
+}
+
+} // namespace
+
+PipelinedLexer::PipelinedLexer(std::string_view in, std::size_t capacity)
+    : ring(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+      mask{ring.size() - 1}, head{0}, knownTail{0}, tail{0}, stopping{false},
+      eof{}, finished{false} {
+  producer = std::thread{&PipelinedLexer::produce, this, Lexer{in}};
+}
+
+PipelinedLexer::PipelinedLexer(std::string_view in, Interner &s,
+                               std::size_t capacity)
+    : ring(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+      mask{ring.size() - 1}, head{0}, knownTail{0}, tail{0}, stopping{false},
+      eof{}, finished{false} {
+  producer = std::thread{&PipelinedLexer::produce, this, Lexer{in, s}};
+}
+
+PipelinedLexer::~PipelinedLexer() {
+  stopping.store(true, std::memory_order_relaxed);
+  producer.join();
+}
+
+void PipelinedLexer::produce(Lexer lexer) {
+  std::size_t next = 0;
+  std::size_t knownHead = 0;
+  while (true) {
+    Token token = lexer.nextToken();
+
+    // Wait for a free slot. The head is only reloaded when the ring looks
+    // full, so while there is room the producer never reads the consumer's
+    // cache line.
+    while (next - knownHead == ring.size()) {
+      knownHead = head.load(std::memory_order_acquire);
+      if (next - knownHead == ring.size()) {
+        if (stopping.load(std::memory_order_relaxed)) {
+          return;
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    ring[next & mask] = token;
+    tail.store(++next, std::memory_order_release);
+    if (token.Type == TokenKind::EOF_) {
+      return;
+    }
+  }
+}
+
+Token PipelinedLexer::nextToken() {
+  if (finished) {
+    return eof;
+  }
+
+  std::size_t next = head.load(std::memory_order_relaxed);
+  while (next == knownTail) {
+    knownTail = tail.load(std::memory_order_acquire);
+    if (next == knownTail) {
+      std::this_thread::yield();
+    }
+  }
+
+  Token token = ring[next & mask];
+  head.store(next + 1, std::memory_order_release);
+  if (token.Type == TokenKind::EOF_) {
+    eof = token;
+    finished = true;
+  }
+  return token;
+}
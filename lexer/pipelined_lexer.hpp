@@ -0,0 +1,58 @@
+#pragma once
+#include "../token/interner.hpp"
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include "token_source.hpp"
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Lexes on a background thread while the consumer (usually the Parser) takes
+// tokens on its own, so lexing and parsing overlap instead of running back to
+// back. The two threads share a fixed size single-producer/single-consumer
+// ring of tokens and never take a lock: each side owns one index and only
+// reads the other's.
+//
+// Returns exactly the tokens a Lexer over the same input would. Like a Lexer
+// it borrows the input, which has to outlive the tokens.
+class PipelinedLexer : public TokenSource {
+private:
+  std::vector<Token> ring;
+  std::size_t mask;
+
+  // Index of the next token to read, written only by the consumer
+  alignas(64) std::atomic<std::size_t> head;
+  // Last value of tail seen by the consumer, to touch the shared line less
+  std::size_t knownTail;
+
+  // Index of the next slot to write, written only by the producer
+  alignas(64) std::atomic<std::size_t> tail;
+
+  // Set by the destructor to stop a producer waiting on a full ring
+  alignas(64) std::atomic<bool> stopping;
+
+  // The EOF token, handed out again once the ring is drained
+  Token eof;
+  bool finished;
+
+  std::thread producer;
+
+  void produce(Lexer lexer);
+
+public:
+  // capacity is rounded up to a power of two.
+  PipelinedLexer(std::string_view in, std::size_t capacity = 4096);
+
+  // Also interns every identifier into s, from the lexing thread.
+  PipelinedLexer(std::string_view in, Interner &s,
+                 std::size_t capacity = 4096);
+
+  PipelinedLexer(const PipelinedLexer &) = delete;
+  PipelinedLexer &operator=(const PipelinedLexer &) = delete;
+
+  ~PipelinedLexer();
+
+  Token nextToken() override;
+};
@@ -0,0 +1,113 @@
+#include "relex.hpp"
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include "token_buffer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// Whether the lexer may have read more than one byte past token i: it only
+// does when it decoded a UTF-8 sequence, either right after the token or as
+// the token itself, and when a number was followed by what could have been
+// a fraction or an exponent. Bytes before the edit still hold the old source.
+bool readsPastEnd(const TokenBuffer &tokens, std::string_view source,
+                  std::size_t i) {
+  auto nonAscii = [&](std::size_t at) {
+    return at < source.size() && static_cast<unsigned char>(source[at]) >= 0x80;
+  };
+  auto numberSuffix = [&](std::size_t at) {
+    return at < source.size() &&
+           (source[at] == '.' || source[at] == 'e' || source[at] == 'E');
+  };
+  TokenKind kind = tokens.kind(i);
+  return nonAscii(tokens.end(i)) ||
+         (kind == TokenKind::ILLEGAL && nonAscii(tokens.start(i))) ||
+         ((kind == TokenKind::INT || kind == TokenKind::FLOAT) &&
+          numberSuffix(tokens.end(i)));
+}
+
+} // namespace
+
+RelexResult relex(TokenBuffer &tokens, std::string &source,
+                  const SourceEdit &edit) {
+  if (edit.offset > source.size() ||
+      edit.removedLength > source.size() - edit.offset) {
+    throw std::out_of_range("relex: edit outside of the source");
+  }
+  if (source.size() - edit.removedLength + edit.insertedText.size() >
+      std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("relex: source larger than 4 GiB");
+  }
+
+  // The lexer decides a token by looking one byte past its end, so every
+  // token ending strictly before the edit is unchanged. Start lexing again
+  // right after the last of them.
+  std::size_t first = 0;
+  std::size_t last = tokens.size();
+  while (first < last) {
+    std::size_t middle = first + (last - first) / 2;
+    if (tokens.end(middle) < edit.offset) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  // The EOF token is always lexed again, even when the old stream ended at
+  // a NUL byte before the edit.
+  first = std::min(first, tokens.size() - 1);
+  // Only UTF-8 and numbers make it look further, up to maxLookahead bytes.
+  // That can reach over the tokens in between: "2" in "2e+y" looks at "y".
+  for (std::size_t i = first;
+       i > 0 && tokens.end(i - 1) + maxLookahead > edit.offset; --i) {
+    if (readsPastEnd(tokens, source, i - 1)) {
+      first = i - 1;
+    }
+  }
+  std::size_t resume = first == 0 ? 0 : tokens.end(first - 1);
+
+  source.replace(edit.offset, edit.removedLength, edit.insertedText);
+  std::size_t editEnd = edit.offset + edit.insertedText.size();
+  std::int64_t delta = static_cast<std::int64_t>(edit.insertedText.size()) -
+                       static_cast<std::int64_t>(edit.removedLength);
+
+  // Lex until a token starts past the inserted text at the same place an
+  // old token started past the removed text; from there on both streams
+  // read the same bytes.
+  std::size_t old = first;
+  TokenBuffer fresh{};
+  // source is a std::string, so it ends in a NUL
+  TerminatedLexer l{source, resume};
+  while (true) {
+    Token token = l.nextToken();
+    std::size_t start = token.Literal.data() - source.data();
+    if (start >= editEnd) {
+      // Maps back to an offset at or past the end of the removed text
+      std::size_t oldStart = static_cast<std::size_t>(start - delta);
+      while (old < tokens.size() && tokens.start(old) < oldStart) {
+        ++old;
+      }
+      if (old < tokens.size() && tokens.start(old) == oldStart) {
+        break;
+      }
+    }
+    fresh.push(token.Type, static_cast<std::uint32_t>(start),
+               static_cast<std::uint32_t>(token.Literal.size()));
+    if (token.Type == TokenKind::EOF_) {
+      old = tokens.size();
+      break;
+    }
+  }
+
+  // Swaps the re-lexed tokens in where the edit was; the tokens after it
+  // are neither moved nor shifted one by one.
+  tokens.replace(first, old, fresh, delta);
+  tokens.source = source;
+
+  return RelexResult{first, old - first, fresh.size()};
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "token_buffer.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Replace removedLength bytes at offset with insertedText.
+struct SourceEdit {
+  std::size_t offset;
+  std::size_t removedLength;
+  std::string_view insertedText;
+};
+
+// Which tokens relex replaced: [firstToken, firstToken + removedTokens) of the
+// old stream became [firstToken, firstToken + insertedTokens) of the new one.
+struct RelexResult {
+  std::size_t firstToken;
+  std::size_t removedTokens;
+  std::size_t insertedTokens;
+};
+
+// Applies edit to source and brings tokens (a tokenize() of the old source)
+// up to date. Only the tokens from just before the edit up to the point where
+// the new stream falls back in step with the old one are lexed again, and
+// the TokenBuffer's gap follows the edits, so the tokens after an edit are
+// not touched. The work follows the size of the edit and its distance from
+// the previous one rather than the size of the file, apart from
+// std::string::replace moving the bytes of source. Brackets are matched
+// again only around the edit unless it changes which brackets there are.
+// Throws std::out_of_range if the edit does not lie within source.
+RelexResult relex(TokenBuffer &tokens, std::string &source,
+                  const SourceEdit &edit);
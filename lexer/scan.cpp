@@ -0,0 +1,242 @@
+#include "scan.hpp"
+#include "lexer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MONKEY_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Portable fallbacks, also used to finish the last few bytes the vector
+// kernels cannot load a whole register for.
+std::size_t whitespaceScalar(std::string_view input, std::size_t pos) {
+  while (pos < input.size() && isWhitespace(input[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+std::size_t identifierScalar(std::string_view input, std::size_t pos) {
+  while (pos < input.size() && isLetter(input[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+std::size_t digitsScalar(std::string_view input, std::size_t pos) {
+  while (pos < input.size() && isDigit(input[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+void lineStartsScalar(std::string_view input, std::size_t pos,
+                      std::vector<std::uint32_t> &starts) {
+  for (; pos < input.size(); ++pos) {
+    if (input[pos] == '\n') {
+      starts.push_back(static_cast<std::uint32_t>(pos + 1));
+    }
+  }
+}
+
+void lineStartsScalar(std::string_view input,
+                      std::vector<std::uint32_t> &starts) {
+  lineStartsScalar(input, 0, starts);
+}
+
+#ifdef MONKEY_SCAN_X86
+
+// Each Match function returns a byte mask with 0xFF for every byte in the
+// charachter class. Comparisons are signed, so bytes >= 0x80 never match.
+
+__attribute__((target("sse2"))) inline __m128i
+whitespaceMatch128(__m128i chunk) {
+  __m128i space = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+  __m128i tab = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'));
+  __m128i newline = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+  __m128i carriage = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'));
+  return _mm_or_si128(_mm_or_si128(space, tab),
+                      _mm_or_si128(newline, carriage));
+}
+
+__attribute__((target("sse2"))) inline __m128i
+identifierMatch128(__m128i chunk) {
+  // Setting bit 5 folds upper case onto lower case
+  __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+  __m128i underscore = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+  return _mm_or_si128(alpha, underscore);
+}
+
+__attribute__((target("sse2"))) inline __m128i digitsMatch128(__m128i chunk) {
+  return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                       _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+}
+
+__attribute__((target("avx2"))) inline __m256i
+whitespaceMatch256(__m256i chunk) {
+  __m256i space = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '));
+  __m256i tab = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'));
+  __m256i newline = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+  __m256i carriage = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'));
+  return _mm256_or_si256(_mm256_or_si256(space, tab),
+                         _mm256_or_si256(newline, carriage));
+}
+
+__attribute__((target("avx2"))) inline __m256i
+identifierMatch256(__m256i chunk) {
+  __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+  __m256i alpha =
+      _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+  __m256i underscore = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_'));
+  return _mm256_or_si256(alpha, underscore);
+}
+
+__attribute__((target("avx2"))) inline __m256i digitsMatch256(__m256i chunk) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+}
+
+// Classify 16 bytes at a time and stop on the first one outside the class.
+template <__m128i (*Match)(__m128i),
+          std::size_t (*Scalar)(std::string_view, std::size_t)>
+__attribute__((target("sse2"))) std::size_t scan128(std::string_view input,
+                                                    std::size_t pos) {
+  const char *data = input.data();
+  while (pos + 16 <= input.size()) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    unsigned mask = ~unsigned(_mm_movemask_epi8(Match(chunk))) & 0xFFFFu;
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+    pos += 16;
+  }
+  return Scalar(input, pos);
+}
+
+// Same as scan128 with 32 byte registers.
+template <__m256i (*Match)(__m256i),
+          std::size_t (*Scalar)(std::string_view, std::size_t)>
+__attribute__((target("avx2"))) std::size_t scan256(std::string_view input,
+                                                    std::size_t pos) {
+  const char *data = input.data();
+  while (pos + 32 <= input.size()) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    unsigned mask = ~unsigned(_mm256_movemask_epi8(Match(chunk)));
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+    pos += 32;
+  }
+  return Scalar(input, pos);
+}
+
+// Newlines are rare, so most 16 or 32 byte blocks are a compare and a zero
+// mask; the set bits of the rest give the newline positions directly.
+__attribute__((target("sse2"))) void
+lineStarts128(std::string_view input, std::vector<std::uint32_t> &starts) {
+  const char *data = input.data();
+  const __m128i newline = _mm_set1_epi8('\n');
+  std::size_t pos = 0;
+  for (; pos + 16 <= input.size(); pos += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+    while (mask != 0) {
+      starts.push_back(
+          static_cast<std::uint32_t>(pos + __builtin_ctz(mask) + 1));
+      mask &= mask - 1;
+    }
+  }
+  lineStartsScalar(input, pos, starts);
+}
+
+__attribute__((target("avx2"))) void
+lineStarts256(std::string_view input, std::vector<std::uint32_t> &starts) {
+  const char *data = input.data();
+  const __m256i newline = _mm256_set1_epi8('\n');
+  std::size_t pos = 0;
+  for (; pos + 32 <= input.size(); pos += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    unsigned mask =
+        unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+    while (mask != 0) {
+      starts.push_back(
+          static_cast<std::uint32_t>(pos + __builtin_ctz(mask) + 1));
+      mask &= mask - 1;
+    }
+  }
+  lineStartsScalar(input, pos, starts);
+}
+
+const ScanKernels sse2Kernels{
+    scan128<whitespaceMatch128, whitespaceScalar>,
+    scan128<identifierMatch128, identifierScalar>,
+    scan128<digitsMatch128, digitsScalar>,
+    lineStarts128,
+};
+
+const ScanKernels avx2Kernels{
+    scan256<whitespaceMatch256, whitespaceScalar>,
+    scan256<identifierMatch256, identifierScalar>,
+    scan256<digitsMatch256, digitsScalar>,
+    lineStarts256,
+};
+
+#endif
+
+const ScanKernels scalarKernels{
+    whitespaceScalar,
+    identifierScalar,
+    digitsScalar,
+    lineStartsScalar,
+};
+
+} // namespace
+
+bool scanLevelSupported(ScanLevel level) {
+  switch (level) {
+  case ScanLevel::SCALAR:
+    return true;
+#ifdef MONKEY_SCAN_X86
+  case ScanLevel::SSE2:
+    return __builtin_cpu_supports("sse2");
+  case ScanLevel::AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+const ScanKernels &scanKernelsFor(ScanLevel level) {
+  switch (level) {
+#ifdef MONKEY_SCAN_X86
+  case ScanLevel::SSE2:
+    return sse2Kernels;
+  case ScanLevel::AVX2:
+    return avx2Kernels;
+#endif
+  default:
+    return scalarKernels;
+  }
+}
+
+const ScanKernels &scanKernels() {
+  static const ScanKernels &best =
+      scanLevelSupported(ScanLevel::AVX2)   ? scanKernelsFor(ScanLevel::AVX2)
+      : scanLevelSupported(ScanLevel::SSE2) ? scanKernelsFor(ScanLevel::SSE2)
+                                            : scalarKernels;
+  return best;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Kernels that skip over a run of one charachter class and return the index
+// of the first byte at or after `pos` that is not in the class (or the size of
+// the input). The Lexer uses them to jump over whitespace, identifiers and
+// numbers instead of calling readChar() once per byte.
+struct ScanKernels {
+  std::size_t (*whitespace)(std::string_view input, std::size_t pos);
+  std::size_t (*identifier)(std::string_view input, std::size_t pos);
+  std::size_t (*digits)(std::string_view input, std::size_t pos);
+
+  // Appends the offset just past every '\n' in input, i.e. the start of
+  // every line but the first.
+  void (*lineStarts)(std::string_view input,
+                     std::vector<std::uint32_t> &starts);
+};
+
+enum class ScanLevel {
+  SCALAR,
+  SSE2,
+  AVX2,
+};
+
+// True if this build and this CPU can run the kernels of the given level.
+bool scanLevelSupported(ScanLevel level);
+
+// Kernels of one specific level. The level has to be supported.
+const ScanKernels &scanKernelsFor(ScanLevel level);
+
+// The fastest kernels the CPU supports, picked once on first use.
+const ScanKernels &scanKernels();
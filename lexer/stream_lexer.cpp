@@ -0,0 +1,62 @@
+#include "stream_lexer.hpp"
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <string_view>
+
+StreamLexer::StreamLexer(std::istream &i, std::size_t chunk)
+    : in{i}, chunkSize{chunk == 0 ? 1 : chunk}, buffer{}, filled{},
+      consumed{}, discarded{}, exhausted{false}, lastOffset{}, lexer{""} {
+  buffer.resize(2 * chunkSize);
+  refill();
+}
+
+std::string_view StreamLexer::window() const {
+  return std::string_view(buffer.data() + consumed, filled - consumed);
+}
+
+void StreamLexer::refill() {
+  std::memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+  filled -= consumed;
+  discarded += consumed;
+  consumed = 0;
+
+  // Only a token longer than the buffer makes it grow. One byte is kept for
+  // the NUL after the input that the TerminatedLexer stops on.
+  if (buffer.size() - filled <= chunkSize) {
+    buffer.resize(filled + chunkSize + 1);
+  }
+  in.read(buffer.data() + filled, static_cast<std::streamsize>(chunkSize));
+  std::size_t read = static_cast<std::size_t>(in.gcount());
+  filled += read;
+  buffer[filled] = '\0';
+  exhausted = read < chunkSize;
+  lexer = TerminatedLexer{window()};
+}
+
+Token StreamLexer::nextToken() {
+  while (true) {
+    Token token = lexer.nextToken();
+    std::size_t end =
+        token.Literal.data() + token.Literal.size() - buffer.data();
+
+    // A token that ends within maxLookahead of the end of the buffer could
+    // come out differently with the next chunk (an identifier, "=" before
+    // "=", a cut UTF-8 sequence, or EOF before more input), so read more and
+    // lex it again from where it started.
+    if (end + maxLookahead > filled && !exhausted) {
+      refill();
+      continue;
+    }
+    consumed = end;
+    // The lexer counts from the start of the buffer, not of the stream
+    lastOffset = discarded + token.Offset;
+    token.Offset = lastOffset < offsetOverflow
+                       ? static_cast<std::uint32_t>(lastOffset)
+                       : offsetOverflow;
+    return token;
+  }
+}
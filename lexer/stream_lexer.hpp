@@ -0,0 +1,51 @@
+#pragma once
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include "token_source.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string_view>
+#include <vector>
+
+// Lexes a program read from a std::istream in fixed size chunks, so memory
+// stays bounded by the chunk size (or the longest single token or comment) no
+// matter how much input is piped through it.
+//
+// The returned tokens view the internal buffer and are only valid until the
+// next call to nextToken(). Token::Offset counts from the start of the
+// stream; past 4 GiB it no longer fits and is offsetOverflow, while
+// streamOffset() keeps counting. That suits consumers that look at one token
+// at a time; the Parser keeps tokens around and needs a Lexer over a whole
+// buffer.
+class StreamLexer : public TokenSource {
+private:
+  std::istream &in;
+  std::size_t chunkSize;
+  std::vector<char> buffer;
+  // Bytes of buffer holding input, and where the unconsumed part starts
+  std::size_t filled;
+  std::size_t consumed;
+  // Bytes of the stream already dropped from the front of the buffer
+  std::size_t discarded;
+  bool exhausted;
+  // Offset in the stream of the last token returned
+  std::uint64_t lastOffset;
+  TerminatedLexer lexer;
+
+  // Drops the consumed prefix of the buffer and appends the next chunk.
+  void refill();
+
+  std::string_view window() const;
+
+public:
+  StreamLexer(std::istream &i, std::size_t chunk = 64 * 1024);
+
+  Token nextToken() override;
+
+  // Offset of the last token nextToken() returned from the start of the
+  // stream, also past 4 GiB.
+  std::uint64_t streamOffset() const { return lastOffset; }
+
+  std::size_t bufferCapacity() const { return buffer.capacity(); }
+};
@@ -0,0 +1,41 @@
+#include "../../bench/counting_alloc.hpp"
+#include "../../token/token.hpp"
+#include "../lexer.hpp"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <string>
+
+TEST(LexerAllocations, NoAllocationPerToken) {
+  std::string input{};
+  while (input.size() < 4 * 1024 * 1024) {
+    input += "let a_rather_long_identifier = fn(x, y) { x + y * 1234567; };"
+             "if (10 == 10) { return !true; } else { return 5 != 9 - 2 / 1; }"
+             "let result = a_rather_long_identifier(five, ten) < 8 > 3;\n";
+  }
+  // Growing input went through the counting operator new
+  ASSERT_GT(allocationCount(), 0u);
+
+  std::size_t before = allocationCount();
+  Lexer l{input};
+  std::size_t tokens = 0;
+  while (l.nextToken().Type != TokenKind::EOF_) {
+    ++tokens;
+  }
+  std::size_t allocations = allocationCount() - before;
+
+  EXPECT_GT(tokens, 1000000u);
+  EXPECT_EQ(allocations, 0u) << "lexer allocated while producing " << tokens
+                             << " tokens";
+}
+
+TEST(LexerAllocations, LiteralsPointIntoSource) {
+  std::string input{"let five = 5; five == 5;"};
+  Lexer l{input};
+
+  for (Token token = l.nextToken(); token.Type != TokenKind::EOF_;
+       token = l.nextToken()) {
+    EXPECT_GE(token.Literal.data(), input.data());
+    EXPECT_LE(token.Literal.data() + token.Literal.size(),
+              input.data() + input.size());
+  }
+}
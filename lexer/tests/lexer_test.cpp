@@ -1,15 +1,34 @@
+#include "../../token/interner.hpp"
 #include "../../token/token.hpp"
 #include "../lexer.hpp"
+#include "../line_table.hpp"
+#include "../pipelined_lexer.hpp"
+#include "../relex.hpp"
+#include "../scan.hpp"
+#include "../stream_lexer.hpp"
+#include "../token_buffer.hpp"
+#include "../utf8.hpp"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <sstream>
+#include <streambuf>
+#include <stdexcept>
+#include <thread>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include <sys/mman.h>
+
 struct TestToken {
-  TokenType_t expectedType;
+  TokenKind expectedType;
   std::string expectedLiteral;
 
-  TestToken(std::string_view t, std::string l)
+  TestToken(TokenKind t, std::string l)
       : expectedType{t}, expectedLiteral{l} {};
 };
 
@@ -20,7 +39,7 @@ TEST(Lexer, TestNextToken) {
                     "   x + y; "
                     "};"
                     "let result = add(five, ten);"
-                    "!-/*5;"
+                    "!-/ *5;"
                     "5 < 10 > 5;"
                     "if (5 < 10) {"
                     "   return true;"
@@ -31,43 +50,43 @@ TEST(Lexer, TestNextToken) {
                     "10 != 9;"};
 
   std::vector<TestToken> TestCases = {
-      {TokenTypes::LET, "let"},     {TokenTypes::IDENT, "five"},
-      {TokenTypes::ASSIGN, "="},    {TokenTypes::INT, "5"},
-      {TokenTypes::SEMICOLON, ";"}, {TokenTypes::LET, "let"},
-      {TokenTypes::IDENT, "ten"},   {TokenTypes::ASSIGN, "="},
-      {TokenTypes::INT, "10"},      {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::LET, "let"},     {TokenTypes::IDENT, "add"},
-      {TokenTypes::ASSIGN, "="},    {TokenTypes::FUNCTION, "fn"},
-      {TokenTypes::LPAREN, "("},    {TokenTypes::IDENT, "x"},
-      {TokenTypes::COMMA, ","},     {TokenTypes::IDENT, "y"},
-      {TokenTypes::RPAREN, ")"},    {TokenTypes::LBRACE, "{"},
-      {TokenTypes::IDENT, "x"},     {TokenTypes::PLUS, "+"},
-      {TokenTypes::IDENT, "y"},     {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::RBRACE, "}"},    {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::LET, "let"},     {TokenTypes::IDENT, "result"},
-      {TokenTypes::ASSIGN, "="},    {TokenTypes::IDENT, "add"},
-      {TokenTypes::LPAREN, "("},    {TokenTypes::IDENT, "five"},
-      {TokenTypes::COMMA, ","},     {TokenTypes::IDENT, "ten"},
-      {TokenTypes::RPAREN, ")"},    {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::BANG, "!"},      {TokenTypes::MINUS, "-"},
-      {TokenTypes::SLASH, "/"},     {TokenTypes::ASTERISK, "*"},
-      {TokenTypes::INT, "5"},       {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::INT, "5"},       {TokenTypes::LT, "<"},
-      {TokenTypes::INT, "10"},      {TokenTypes::GT, ">"},
-      {TokenTypes::INT, "5"},       {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::IF, "if"},       {TokenTypes::LPAREN, "("},
-      {TokenTypes::INT, "5"},       {TokenTypes::LT, "<"},
-      {TokenTypes::INT, "10"},      {TokenTypes::RPAREN, ")"},
-      {TokenTypes::LBRACE, "{"},    {TokenTypes::RETURN, "return"},
-      {TokenTypes::TRUE, "true"},   {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::RBRACE, "}"},    {TokenTypes::ELSE, "else"},
-      {TokenTypes::LBRACE, "{"},    {TokenTypes::RETURN, "return"},
-      {TokenTypes::FALSE, "false"}, {TokenTypes::SEMICOLON, ";"},
-      {TokenTypes::RBRACE, "}"},    {TokenTypes::INT, "10"},
-      {TokenTypes::EQ, "=="},       {TokenTypes::INT, "10"},
-      {TokenTypes::SEMICOLON, ";"}, {TokenTypes::INT, "10"},
-      {TokenTypes::NOT_EQ, "!="},   {TokenTypes::INT, "9"},
-      {TokenTypes::SEMICOLON, ";"}, {TokenTypes::EOF_, ""}};
+      {TokenKind::LET, "let"},     {TokenKind::IDENT, "five"},
+      {TokenKind::ASSIGN, "="},    {TokenKind::INT, "5"},
+      {TokenKind::SEMICOLON, ";"}, {TokenKind::LET, "let"},
+      {TokenKind::IDENT, "ten"},   {TokenKind::ASSIGN, "="},
+      {TokenKind::INT, "10"},      {TokenKind::SEMICOLON, ";"},
+      {TokenKind::LET, "let"},     {TokenKind::IDENT, "add"},
+      {TokenKind::ASSIGN, "="},    {TokenKind::FUNCTION, "fn"},
+      {TokenKind::LPAREN, "("},    {TokenKind::IDENT, "x"},
+      {TokenKind::COMMA, ","},     {TokenKind::IDENT, "y"},
+      {TokenKind::RPAREN, ")"},    {TokenKind::LBRACE, "{"},
+      {TokenKind::IDENT, "x"},     {TokenKind::PLUS, "+"},
+      {TokenKind::IDENT, "y"},     {TokenKind::SEMICOLON, ";"},
+      {TokenKind::RBRACE, "}"},    {TokenKind::SEMICOLON, ";"},
+      {TokenKind::LET, "let"},     {TokenKind::IDENT, "result"},
+      {TokenKind::ASSIGN, "="},    {TokenKind::IDENT, "add"},
+      {TokenKind::LPAREN, "("},    {TokenKind::IDENT, "five"},
+      {TokenKind::COMMA, ","},     {TokenKind::IDENT, "ten"},
+      {TokenKind::RPAREN, ")"},    {TokenKind::SEMICOLON, ";"},
+      {TokenKind::BANG, "!"},      {TokenKind::MINUS, "-"},
+      {TokenKind::SLASH, "/"},     {TokenKind::ASTERISK, "*"},
+      {TokenKind::INT, "5"},       {TokenKind::SEMICOLON, ";"},
+      {TokenKind::INT, "5"},       {TokenKind::LT, "<"},
+      {TokenKind::INT, "10"},      {TokenKind::GT, ">"},
+      {TokenKind::INT, "5"},       {TokenKind::SEMICOLON, ";"},
+      {TokenKind::IF, "if"},       {TokenKind::LPAREN, "("},
+      {TokenKind::INT, "5"},       {TokenKind::LT, "<"},
+      {TokenKind::INT, "10"},      {TokenKind::RPAREN, ")"},
+      {TokenKind::LBRACE, "{"},    {TokenKind::RETURN, "return"},
+      {TokenKind::TRUE, "true"},   {TokenKind::SEMICOLON, ";"},
+      {TokenKind::RBRACE, "}"},    {TokenKind::ELSE, "else"},
+      {TokenKind::LBRACE, "{"},    {TokenKind::RETURN, "return"},
+      {TokenKind::FALSE, "false"}, {TokenKind::SEMICOLON, ";"},
+      {TokenKind::RBRACE, "}"},    {TokenKind::INT, "10"},
+      {TokenKind::EQ, "=="},       {TokenKind::INT, "10"},
+      {TokenKind::SEMICOLON, ";"}, {TokenKind::INT, "10"},
+      {TokenKind::NOT_EQ, "!="},   {TokenKind::INT, "9"},
+      {TokenKind::SEMICOLON, ";"}, {TokenKind::EOF_, ""}};
 
   Lexer l{input};
 
@@ -79,3 +98,756 @@ TEST(Lexer, TestNextToken) {
     EXPECT_EQ(token.Literal, testToken.expectedLiteral);
   }
 }
+
+TEST(Lexer, TestKeywordLookup) {
+  for (auto &&keyword : keywords) {
+    EXPECT_EQ(lookupIdent(keyword.text), keyword.kind) << keyword.text;
+  }
+
+  std::vector<std::string> identifiers = {
+      "f",   "fnn", "lett",   "le",      "tru", "falsey", "iff",
+      "els", "Let", "RETURN", "returns", "x",   "_",      "letter",
+  };
+  for (auto &&ident : identifiers) {
+    EXPECT_EQ(lookupIdent(ident), TokenKind::IDENT) << ident;
+  }
+}
+
+TEST(Lexer, TestScanKernelsMatchScalar) {
+  // Runs of every charachter class with lengths around the 16 and 32 byte
+  // register widths, bytes >= 0x80 and a NUL in the middle.
+  std::string input{};
+  std::vector<std::string> pieces = {
+      " ",        "\t\t",               "\r\n", "    ", "x",  "_abc", "Zz09",
+      "\x80\xff", std::string(1, '\0'), "7",    "123",  "{",  "=",    "`@[",
+  };
+  for (int i = 0; i < 400; ++i) {
+    input += pieces[(i * 7 + i / 3) % pieces.size()];
+    input += std::string((i * 5) % 37, "a 9"[i % 3]);
+  }
+
+  const ScanKernels &scalar = scanKernelsFor(ScanLevel::SCALAR);
+  for (ScanLevel level : {ScanLevel::SSE2, ScanLevel::AVX2}) {
+    if (!scanLevelSupported(level)) {
+      continue;
+    }
+    const ScanKernels &kernels = scanKernelsFor(level);
+    for (std::size_t pos = 0; pos <= input.size(); ++pos) {
+      ASSERT_EQ(kernels.whitespace(input, pos), scalar.whitespace(input, pos));
+      ASSERT_EQ(kernels.identifier(input, pos), scalar.identifier(input, pos));
+      ASSERT_EQ(kernels.digits(input, pos), scalar.digits(input, pos));
+    }
+    for (std::size_t length = 0; length <= 100; ++length) {
+      std::string_view prefix{input.data(), length};
+      std::vector<std::uint32_t> expected, actual;
+      scalar.lineStarts(prefix, expected);
+      kernels.lineStarts(prefix, actual);
+      ASSERT_EQ(actual, expected);
+    }
+    std::vector<std::uint32_t> expected, actual;
+    scalar.lineStarts(input, expected);
+    kernels.lineStarts(input, actual);
+    ASSERT_EQ(actual, expected);
+  }
+}
+
+TEST(Lexer, TestOperatorsAndIllegalCharachters) {
+  std::string input{"a=b==c!d!=e@ ?==!"};
+
+  std::vector<TestToken> TestCases = {
+      {TokenKind::IDENT, "a"},   {TokenKind::ASSIGN, "="},
+      {TokenKind::IDENT, "b"},   {TokenKind::EQ, "=="},
+      {TokenKind::IDENT, "c"},   {TokenKind::BANG, "!"},
+      {TokenKind::IDENT, "d"},   {TokenKind::NOT_EQ, "!="},
+      {TokenKind::IDENT, "e"},   {TokenKind::ILLEGAL, "@"},
+      {TokenKind::ILLEGAL, "?"}, {TokenKind::EQ, "=="},
+      {TokenKind::BANG, "!"},    {TokenKind::EOF_, ""}};
+
+  Lexer l{input};
+
+  for (auto &&testToken : TestCases) {
+    Token token = l.nextToken();
+
+    EXPECT_EQ(token.Type, testToken.expectedType);
+    EXPECT_EQ(token.Literal, testToken.expectedLiteral);
+  }
+}
+
+TEST(Lexer, TestTokenizeMatchesNextToken) {
+  std::string input{"let add = fn(x, y) { x + y; };\n"
+                    "if (add(1, 22) != 333) { return !true; } else { 5 / 0 }"
+                    " == @ \"a \\\"string\\\"\" 3.25 6e+2 1.x 2e;"};
+
+  TokenBuffer tokens = tokenize(input);
+  static_assert(sizeof(TokenKind) == 1);
+
+  Lexer l{input};
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    Token token = l.nextToken();
+    EXPECT_EQ(tokens.kind(i), token.Type);
+    EXPECT_EQ(tokens.literal(i), token.Literal);
+    EXPECT_EQ(tokens.literal(i).data(), token.Literal.data());
+    if (token.Type == TokenKind::STRING) {
+      EXPECT_EQ(tokens.token(i).HasEscapes, token.HasEscapes);
+    }
+  }
+  EXPECT_EQ(tokens.kind(tokens.size() - 1), TokenKind::EOF_);
+
+  TokenBufferReader reader{tokens};
+  for (std::size_t i = 0; i < tokens.size() + 3; ++i) {
+    Token token = reader.nextToken();
+    std::size_t expected = std::min(i, tokens.size() - 1);
+    EXPECT_EQ(token.Type, tokens.kind(expected));
+    EXPECT_EQ(token.Literal, tokens.literal(expected));
+  }
+}
+
+TEST(Lexer, TestTerminatedLexerMatchesLexer) {
+  std::vector<std::string> inputs{
+      "",
+      "let five = 5; fn(x, y) { x + y; } == != @ \"a \\\"b\\\"\"",
+      "x // comment at the end",
+      "größe = λ + 数据 € \xff ab\xe2\x82",
+      "\"unterminated",
+      // A NUL inside the input ends it for both
+      std::string{"a = 1;\0b = 2;", 13},
+  };
+  for (auto &&input : inputs) {
+    Lexer view{input};
+    TerminatedLexer terminated{input};
+    Token expected{};
+    do {
+      expected = view.nextToken();
+      Token token = terminated.nextToken();
+      EXPECT_EQ(token.Type, expected.Type) << input;
+      EXPECT_EQ(token.Literal, expected.Literal) << input;
+      EXPECT_EQ(token.Offset, expected.Offset) << input;
+    } while (expected.Type != TokenKind::EOF_);
+    EXPECT_EQ(terminated.nextToken().Type, TokenKind::EOF_);
+  }
+}
+
+TEST(Lexer, TestStreamLexerMatchesLexer) {
+  std::string input{"let five = 5;\n"
+                    "let a_long_identifier_name = fn(x, y) {   x + y;   };\n"
+                    "if (12345 == 12345) { return true != false; }   \n"
+                    "// a line comment\n/* a block\n comment */ x / y\n"
+                    "!-/ *5 < 10 > 5 @ ==!=    \"a string\" \"\\\"\"\n"
+                    "3.14 1e9 2.5E-3 6.02e+23 1. 7e 7e+x 12.5e\n"
+                    "größe = λ + 数据 € \xff ab\xe2\x82\n"
+                    "\"unterminated"};
+
+  // Chunk sizes small enough to split identifiers, numbers, strings,
+  // comments, "==" and "!="
+  for (std::size_t chunk : {1, 2, 3, 5, 7, 16, 4096}) {
+    std::istringstream in{input};
+    StreamLexer stream{in, chunk};
+    Lexer l{input};
+
+    Token expected{};
+    do {
+      expected = l.nextToken();
+      Token token = stream.nextToken();
+      EXPECT_EQ(token.Type, expected.Type) << "chunk size " << chunk;
+      EXPECT_EQ(token.Literal, expected.Literal) << "chunk size " << chunk;
+      EXPECT_EQ(token.Offset, expected.Offset) << "chunk size " << chunk;
+    } while (expected.Type != TokenKind::EOF_);
+    EXPECT_EQ(stream.nextToken().Type, TokenKind::EOF_);
+  }
+}
+
+TEST(Lexer, TestStreamLexerMemoryIsBounded) {
+  std::string input{};
+  while (input.size() < 1024 * 1024) {
+    input += "let value = compute(first, second) * 42;\n";
+  }
+
+  std::istringstream in{input};
+  StreamLexer stream{in, 256};
+  std::size_t tokens = 0;
+  while (stream.nextToken().Type != TokenKind::EOF_) {
+    ++tokens;
+  }
+  EXPECT_GT(tokens, 100000u);
+  EXPECT_LE(stream.bufferCapacity(), 512u);
+}
+
+TEST(Lexer, TestPipelinedLexerMatchesLexer) {
+  std::string input{"let five = 5;\n"
+                    "let add = fn(x, y) { x + y; }; // comment\n"
+                    "if (10 == 10) { return \"a \\\"string\\\"\"; } @\n"
+                    "größe = λ + 数据 € \xff ab\xe2\x82\n"};
+  while (input.size() < 64 * 1024) {
+    input += "let value = compute(first, second) * 42 != 7;\n";
+  }
+
+  // A ring of 2 makes the threads hand over nearly every token
+  for (std::size_t capacity : {2, 16, 4096}) {
+    PipelinedLexer pipelined{input, capacity};
+    Lexer l{input};
+
+    Token expected{};
+    do {
+      expected = l.nextToken();
+      Token token = pipelined.nextToken();
+      ASSERT_EQ(token.Type, expected.Type) << "capacity " << capacity;
+      ASSERT_EQ(token.Literal, expected.Literal) << "capacity " << capacity;
+      ASSERT_EQ(token.Offset, expected.Offset) << "capacity " << capacity;
+    } while (expected.Type != TokenKind::EOF_);
+    EXPECT_EQ(pipelined.nextToken().Type, TokenKind::EOF_);
+  }
+}
+
+TEST(Lexer, TestPipelinedLexerStopsEarly) {
+  std::string input{};
+  while (input.size() < 1024 * 1024) {
+    input += "let value = compute(first, second) * 42;\n";
+  }
+  // Destroying it before the end must not leave the lexing thread blocked
+  // on a full ring
+  PipelinedLexer pipelined{input, 8};
+  EXPECT_EQ(pipelined.nextToken().Type, TokenKind::LET);
+}
+
+// Endless lines of 1023 'a's, produced without storing the stream.
+class RepeatedLines : public std::streambuf {
+private:
+  std::vector<char> chunk;
+  std::uint64_t left;
+
+public:
+  RepeatedLines(std::uint64_t size) : chunk(1024 * 1024, 'a'), left{size} {
+    for (std::size_t i = 1023; i < chunk.size(); i += 1024) {
+      chunk[i] = '\n';
+    }
+  }
+
+  int_type underflow() override {
+    if (left == 0) {
+      return traits_type::eof();
+    }
+    std::size_t size = std::min<std::uint64_t>(left, chunk.size());
+    left -= size;
+    setg(chunk.data(), chunk.data(), chunk.data() + size);
+    return traits_type::to_int_type(*gptr());
+  }
+};
+
+TEST(Lexer, TestStreamLexerOffsetsPast4GiB) {
+  std::uint64_t lines = (std::uint64_t{1} << 22) + 2;
+  RepeatedLines source{lines * 1024};
+  std::istream in{&source};
+  StreamLexer stream{in, 4 * 1024 * 1024};
+
+  for (std::uint64_t line = 0; line < lines; line++) {
+    Token token = stream.nextToken();
+    ASSERT_EQ(token.Type, TokenKind::IDENT);
+    ASSERT_EQ(stream.streamOffset(), line * 1024);
+    if (line * 1024 < offsetOverflow) {
+      ASSERT_EQ(token.Offset, line * 1024);
+    } else {
+      // Does not wrap around to the start of the stream
+      ASSERT_EQ(token.Offset, offsetOverflow);
+    }
+  }
+  EXPECT_EQ(stream.nextToken().Type, TokenKind::EOF_);
+}
+
+TEST(Lexer, TestLexerRejectsInputsOf4GiB) {
+  // Address space for a 4 GiB input that reads as zeros, without memory
+  std::size_t size = std::size_t{1} << 32;
+  void *mapping = mmap(nullptr, size, PROT_READ,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  ASSERT_NE(mapping, MAP_FAILED);
+  std::string_view huge{static_cast<const char *>(mapping), size};
+  EXPECT_THROW(Lexer{huge}, std::length_error);
+  EXPECT_NO_THROW(Lexer{huge.substr(0, size - 1)});
+  munmap(mapping, size);
+}
+
+void expectSameTokens(const TokenBuffer &actual, const TokenBuffer &expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(actual.kind(i), expected.kind(i)) << "token " << i;
+    ASSERT_EQ(actual.start(i), expected.start(i)) << "token " << i;
+    ASSERT_EQ(actual.length(i), expected.length(i)) << "token " << i;
+    ASSERT_EQ(actual.match(i), expected.match(i)) << "token " << i;
+  }
+}
+
+TEST(Lexer, TestTokenizeParallelMatchesTokenize) {
+  std::string input{};
+  while (input.size() < 2 * 1024 * 1024) {
+    input += "let compute = fn(alpha, beta) { if (alpha == beta) "
+             "{ return alpha * 12345; } else { return !beta != alpha; } };\n";
+    input += "let message = \"fn(x) { \\\"quoted\\\" } \";\n";
+  }
+  // A comment and a string longer than a chunk, full of code-like text
+  input += "/*";
+  while (input.size() < 5 * 1024 * 1024 / 2) {
+    input += "let x = \"y\"; // z\n";
+  }
+  input += "*/\n";
+  input += "\"";
+  while (input.size() < 3 * 1024 * 1024) {
+    input += "let x = \\\"y\\\"; ";
+  }
+  input += "\"; let after = 1;";
+  TokenBuffer expected = tokenize(input);
+
+  for (unsigned threads : {1, 2, 3, 4, 8}) {
+    expectSameTokens(tokenizeParallel(input, threads), expected);
+  }
+}
+
+TEST(Lexer, TestTokenizeChunksResynchronises) {
+  std::string input{"let a_long_identifier = 1234567 == 89;\n"
+                    "if (x != y) { return a_long_identifier + !true; }   "
+                    "\"if (x) { \\\"a\\\" }\" \" \"\"\" \"let\n"
+                    "a // b = c;\n/* \"d\" */ e /* * / */ f / g //\n"
+                    "größe λx €€ 数据 \xe2\x82 \xff"};
+  TokenBuffer expected = tokenize(input);
+
+  // Boundaries every few bytes land inside identifiers, numbers, strings,
+  // "==" and "!=", so most chunks have to be re-lexed around their start.
+  for (std::size_t step : {1, 2, 3, 5, 11, 40}) {
+    std::vector<std::size_t> boundaries{};
+    for (std::size_t cut = 0; cut < input.size(); cut += step) {
+      boundaries.push_back(cut);
+    }
+    boundaries.push_back(input.size());
+    expectSameTokens(tokenizeChunks(input, boundaries), expected);
+  }
+}
+
+TEST(Lexer, TestChunkBoundariesAvoidStringsAndComments) {
+  // Spaces and newlines inside strings, quotes inside comments
+  std::string input{};
+  while (input.size() < 512 * 1024) {
+    input += "let message = \"fn(x) { \\\"quoted\\\" }\\n second line\";\n";
+    input += "let text = \"a\nstring over two lines\"; // says \"hi\n";
+    input += "/* a \"quote\" and // inside */ let y = 1;\n";
+  }
+  TokenBuffer expected = tokenize(input);
+
+  for (std::size_t chunks : {2, 3, 7, 16}) {
+    std::vector<std::size_t> boundaries = chunkBoundaries(input, chunks);
+    ASSERT_EQ(boundaries.size(), chunks + 1);
+    EXPECT_EQ(boundaries.front(), 0u);
+    EXPECT_EQ(boundaries.back(), input.size());
+    // Every cut falls between two tokens of the sequential stream
+    std::size_t token = 0;
+    for (std::size_t cut : boundaries) {
+      while (token < expected.size() && expected.end(token) <= cut) {
+        ++token;
+      }
+      EXPECT_TRUE(token == expected.size() || expected.start(token) >= cut)
+          << "cut at " << cut << " splits " << expected.literal(token);
+    }
+    expectSameTokens(tokenizeChunks(input, boundaries), expected);
+  }
+}
+
+TEST(Lexer, TestBracketMatches) {
+  // Indices: let(0) f(1) =(2) fn(3) ((4) x(5) )(6) {(7) g(8) ((9) ((10)
+  // x(11) )(12) )(13) ;(14) }(15) ;(16) EOF(17)
+  TokenBuffer tokens = tokenize("let f = fn(x) { g((x)); };");
+  std::vector<std::uint32_t> expected(tokens.size(), noMatch);
+  for (auto [open, close] : {std::pair{4u, 6u}, {7u, 15u}, {9u, 13u},
+                             {10u, 12u}}) {
+    expected[open] = close;
+    expected[close] = open;
+  }
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    EXPECT_EQ(tokens.match(i), expected[i]) << "token " << i;
+  }
+  EXPECT_EQ(tokens.firstUnbalanced(), tokens.size());
+
+  // A ")" that does not close the innermost "{" stays unmatched
+  TokenBuffer crossed = tokenize("( { ) }");
+  EXPECT_EQ(crossed.match(1), 3u);
+  EXPECT_EQ(crossed.match(0), noMatch);
+  EXPECT_EQ(crossed.match(2), noMatch);
+  EXPECT_EQ(crossed.firstUnbalanced(), 0u);
+  EXPECT_EQ(tokenize("f(x))").firstUnbalanced(), 4u);
+  EXPECT_EQ(tokenize("fn() { if (x) {").firstUnbalanced(), 3u);
+}
+
+TEST(Lexer, TestRelexMatchesTokenize) {
+  std::string source{"let five = 5;\nlet add = fn(x, y) { x + y; };\n"
+                     "if (five == 5) { return add(five, 10); }"
+                     "let s = \"a \\\"b\\\" c\";"};
+  TokenBuffer tokens = tokenize(source);
+
+  std::vector<SourceEdit> edits = {
+      {4, 4, "fifty"},       // rename an identifier
+      {8, 0, "="},           // "=" becomes "=="
+      {8, 1, ""},            // and back
+      {0, 0, "let z = 1;"},  // insert at the start
+      {10, 0, "x"},          // glue onto the following token
+      {0, 0, "!"},           // "!" in front of "let"
+      {1, 0, "="},           // makes "!=" with the next byte
+      {20, 30, " "},         // delete across several tokens
+      {3, 0, "\""},          // open a string that swallows the rest
+      {3, 1, ""},            // and close it again
+      {source.size(), 0, "\""}, // unterminated string at the end
+      {0, 0, "/*"},          // comment out everything
+      {0, 2, "//"},          // only the first line
+      {0, 2, ""},            // and uncomment it
+      {0, 0, "ab\xe2\x82 "},  // identifier before a cut UTF-8 sequence
+      {4, 0, "\xac"},        // completes it to a euro sign
+      {4, 0, "\xff"},        // breaks it again
+      {2, 5, "\xc3\xa9"},    // which makes a letter: "abé"
+      {source.size(), 0, ""},
+  };
+  for (auto &&edit : edits) {
+    SourceEdit clamped = edit;
+    clamped.offset = std::min(edit.offset, source.size());
+    clamped.removedLength =
+        std::min(edit.removedLength, source.size() - clamped.offset);
+    relex(tokens, source, clamped);
+    expectSameTokens(tokens, tokenize(source));
+  }
+
+  // Appending at the very end
+  relex(tokens, source, {source.size(), 0, " let tail = 1"});
+  expectSameTokens(tokens, tokenize(source));
+  EXPECT_THROW(relex(tokens, source, {source.size() + 1, 0, "x"}),
+               std::out_of_range);
+}
+
+TEST(Lexer, TestRelexWorkFollowsEditSize) {
+  std::string source{};
+  while (source.size() < 1024 * 1024) {
+    source += "let value = compute(first, second) * 42;\n";
+  }
+  TokenBuffer tokens = tokenize(source);
+
+  std::size_t middle = source.size() / 2;
+  middle = source.find("compute", middle);
+  RelexResult result = relex(tokens, source, {middle, 7, "evaluate"});
+
+  expectSameTokens(tokens, tokenize(source));
+  EXPECT_LE(result.removedTokens, 2u);
+  EXPECT_LE(result.insertedTokens, 2u);
+}
+
+TEST(Lexer, TestRelexAfterEmbeddedNul) {
+  // The old stream ends at the NUL, before the edit
+  std::string source{"let x\0 y", 8};
+  TokenBuffer tokens = tokenize(source);
+  ASSERT_EQ(tokens.size(), 3u);
+
+  relex(tokens, source, {source.size(), 0, " z"});
+  expectSameTokens(tokens, tokenize(source));
+  relex(tokens, source, {5, 1, ""});
+  expectSameTokens(tokens, tokenize(source));
+}
+
+TEST(Lexer, TestRelexKeepsBracketsMatched) {
+  std::string source{};
+  for (int i = 0; i < 50; ++i) {
+    source += "let f = fn(x) { if (x) { g((x), [1]) } };\n";
+  }
+  TokenBuffer tokens = tokenize(source);
+
+  // Edits that keep the brackets, then ones that add, remove or retype
+  // them, hopping back and forth so the gap moves both ways.
+  std::vector<std::string> texts = {"y", "", "abc", "(", ")", "{", "} ",
+                                    "((", "\"", "/*", "*/", "{x}", "7"};
+  std::uint32_t random = 12345;
+  for (int i = 0; i < 400; ++i) {
+    random = random * 1103515245 + 12345;
+    std::size_t offset = (random >> 8) % (source.size() + 1);
+    std::size_t removed = (random >> 4) % 4;
+    removed = std::min(removed, source.size() - offset);
+    const std::string &text = texts[(random >> 16) % texts.size()];
+    relex(tokens, source, {offset, removed, text});
+    expectSameTokens(tokens, tokenize(source));
+  }
+}
+
+TEST(Lexer, TestTokenOffsets) {
+  std::string input{"let x =\n  10 != y;\n\tfn"};
+  std::vector<std::uint32_t> expected = {0, 4, 6, 10, 13, 16, 17, 20, 22};
+
+  Lexer l{input};
+  TokenBuffer tokens = tokenize(input);
+  ASSERT_EQ(tokens.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    Token token = l.nextToken();
+    EXPECT_EQ(token.Offset, expected[i]) << "token " << i;
+    EXPECT_EQ(tokens.token(i).Offset, expected[i]) << "token " << i;
+    EXPECT_EQ(input.substr(token.Offset, token.Literal.size()), token.Literal);
+  }
+}
+
+TEST(Lexer, TestLineTable) {
+  std::string input{"let x = 5;\n\nfoo(x);\n  bar"};
+  LineTable lines{input};
+
+  struct Case {
+    std::uint32_t offset;
+    std::uint32_t line;
+    std::uint32_t column;
+  };
+  std::vector<Case> cases = {
+      {0, 1, 1},  {4, 1, 5},  {10, 1, 11}, {11, 2, 1},
+      {12, 3, 1}, {19, 3, 8}, {22, 4, 3},  {100, 4, 6},
+  };
+  for (auto &&c : cases) {
+    SourceLocation location = lines.locate(c.offset);
+    EXPECT_EQ(location.line, c.line) << "offset " << c.offset;
+    EXPECT_EQ(location.column, c.column) << "offset " << c.offset;
+  }
+  EXPECT_EQ(lines.lineCount(), 4);
+  EXPECT_EQ(LineTable{""}.lineCount(), 1);
+}
+
+TEST(Lexer, TestInternerIsDense) {
+  Interner symbols{};
+  EXPECT_EQ(symbols.intern("alpha"), 0);
+  EXPECT_EQ(symbols.intern("beta"), 1);
+  EXPECT_EQ(symbols.intern("alpha"), 0);
+  EXPECT_EQ(symbols.intern(std::string(20000, 'x')), 2);
+  EXPECT_EQ(symbols.size(), 3);
+  EXPECT_EQ(symbols.name(1), "beta");
+  EXPECT_EQ(symbols.name(2), std::string(20000, 'x'));
+}
+
+TEST(Lexer, TestInternerIsThreadSafe) {
+  Interner symbols{};
+  std::vector<std::vector<SymbolId>> ids(4);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < ids.size(); ++t) {
+    threads.emplace_back([&symbols, &ids, t] {
+      for (int i = 0; i < 2000; ++i) {
+        ids[t].push_back(symbols.intern("name" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto &&thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(symbols.size(), 2000);
+  for (std::size_t t = 0; t < ids.size(); ++t) {
+    EXPECT_EQ(ids[t], ids[0]);
+  }
+  for (int i = 0; i < 2000; ++i) {
+    EXPECT_EQ(symbols.name(ids[0][i]), "name" + std::to_string(i));
+  }
+}
+
+TEST(Lexer, TestLexerInternsIdentifiers) {
+  std::string input{"let x = fn(y) { x + y + let_x }; x"};
+  Interner symbols{};
+  Lexer l{input, symbols};
+
+  for (Token token = l.nextToken(); token.Type != TokenKind::EOF_;
+       token = l.nextToken()) {
+    if (token.Type == TokenKind::IDENT) {
+      ASSERT_NE(token.Symbol, noSymbol);
+      EXPECT_EQ(symbols.name(token.Symbol), token.Literal);
+    } else {
+      EXPECT_EQ(token.Symbol, noSymbol) << token.Literal;
+    }
+  }
+  EXPECT_EQ(symbols.size(), 3);
+}
+
+TEST(Lexer, TestIntegerValues) {
+  std::string input{"0 7 0042 1234567890123 9223372036854775807 "
+                    "9223372036854775808 123456789012345678901234567890"};
+  std::vector<std::int64_t> expected = {0, 7, 42, 1234567890123,
+                                        9223372036854775807, integerOverflow,
+                                        integerOverflow};
+
+  Lexer l{input};
+  TokenBuffer tokens = tokenize(input);
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    Token token = l.nextToken();
+    ASSERT_EQ(token.Type, TokenKind::INT);
+    EXPECT_EQ(token.Value, expected[i]) << token.Literal;
+    EXPECT_EQ(tokens.token(i).Value, expected[i]) << token.Literal;
+  }
+}
+
+TEST(Lexer, TestFloatLiterals) {
+  std::string input{"3.14 1e9 2.5E-3 6.02e+23 0.5e0 1e999 1e-999 "
+                    "1. 1.e5 7e 7e+ 4.x"};
+  std::vector<TestToken> expected = {
+      {TokenKind::FLOAT, "3.14"},   {TokenKind::FLOAT, "1e9"},
+      {TokenKind::FLOAT, "2.5E-3"}, {TokenKind::FLOAT, "6.02e+23"},
+      {TokenKind::FLOAT, "0.5e0"},  {TokenKind::FLOAT, "1e999"},
+      {TokenKind::FLOAT, "1e-999"},
+      // A '.' or exponent without digits after it is not part of the number
+      {TokenKind::INT, "1"},        {TokenKind::ILLEGAL, "."},
+      {TokenKind::INT, "1"},        {TokenKind::ILLEGAL, "."},
+      {TokenKind::IDENT, "e"},      {TokenKind::INT, "5"},
+      {TokenKind::INT, "7"},        {TokenKind::IDENT, "e"},
+      {TokenKind::INT, "7"},        {TokenKind::IDENT, "e"},
+      {TokenKind::PLUS, "+"},       {TokenKind::INT, "4"},
+      {TokenKind::ILLEGAL, "."},    {TokenKind::IDENT, "x"},
+      {TokenKind::EOF_, ""},
+  };
+  std::vector<double> values = {3.14,  1e9, 2.5e-3, 6.02e23,
+                                0.5,   std::numeric_limits<double>::infinity(),
+                                0.0};
+
+  Lexer l{input};
+  TokenBuffer tokens = tokenize(input);
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    Token token = l.nextToken();
+    ASSERT_EQ(token.Type, expected[i].expectedType) << "token " << i;
+    EXPECT_EQ(token.Literal, expected[i].expectedLiteral) << "token " << i;
+    if (i < values.size()) {
+      EXPECT_EQ(token.FloatValue, values[i]) << token.Literal;
+      EXPECT_EQ(tokens.token(i).FloatValue, values[i]) << token.Literal;
+    }
+  }
+}
+
+TEST(Lexer, TestRelexNumbers) {
+  // Whether a number goes on depends on up to three bytes after its digits
+  std::string source{"let a = 1.x + 2e+y + 3e;"};
+  TokenBuffer tokens = tokenize(source);
+  std::vector<SourceEdit> edits = {
+      {10, 1, "5"}, // "1.5"
+      {17, 1, "7"}, // "2e+7"
+      {23, 0, "9"}, // "3e9"
+      {17, 1, "z"}, // "2" "e" "+" "z" again
+      {10, 1, ""},  // "1" "." "+"
+  };
+  for (auto &&edit : edits) {
+    relex(tokens, source, edit);
+    expectSameTokens(tokens, tokenize(source));
+  }
+}
+
+TEST(Lexer, TestStringLiterals) {
+  std::string input{R"("" "plain text" "a\"b" "tab\t\\" "unterminated)"};
+
+  struct Expected {
+    TokenKind type;
+    std::string literal;
+    bool hasEscapes;
+    std::string decoded;
+  };
+  std::vector<Expected> expected = {
+      {TokenKind::STRING, R"("")", false, ""},
+      {TokenKind::STRING, R"("plain text")", false, "plain text"},
+      {TokenKind::STRING, R"("a\"b")", true, "a\"b"},
+      {TokenKind::STRING, R"("tab\t\\")", true, "tab\t\\"},
+      {TokenKind::ILLEGAL, R"("unterminated)", false, ""},
+      {TokenKind::EOF_, "", false, ""},
+  };
+
+  Lexer l{input};
+  for (auto &&e : expected) {
+    Token token = l.nextToken();
+    ASSERT_EQ(token.Type, e.type) << token.Literal;
+    EXPECT_EQ(token.Literal, e.literal);
+    if (token.Type == TokenKind::STRING) {
+      EXPECT_EQ(token.HasEscapes, e.hasEscapes) << token.Literal;
+      EXPECT_EQ(decodeEscapes(stringLiteralBody(token.Literal)), e.decoded);
+    }
+  }
+}
+
+TEST(Lexer, TestComments) {
+  std::string input{"let x = 1; // the first\n"
+                    "/* a\n block * / comment */ x / y /**/ z\n"
+                    "// no newline at the end"};
+
+  std::vector<TestToken> TestCases = {
+      {TokenKind::LET, "let"},     {TokenKind::IDENT, "x"},
+      {TokenKind::ASSIGN, "="},    {TokenKind::INT, "1"},
+      {TokenKind::SEMICOLON, ";"}, {TokenKind::IDENT, "x"},
+      {TokenKind::SLASH, "/"},     {TokenKind::IDENT, "y"},
+      {TokenKind::IDENT, "z"},     {TokenKind::EOF_, ""}};
+
+  Lexer l{input};
+  for (auto &&test : TestCases) {
+    Token token = l.nextToken();
+    EXPECT_EQ(token.Type, test.expectedType) << test.expectedLiteral;
+    EXPECT_EQ(token.Literal, test.expectedLiteral);
+  }
+
+  Lexer unclosed{"a /* never closed\n b"};
+  EXPECT_EQ(unclosed.nextToken().Literal, "a");
+  EXPECT_EQ(unclosed.nextToken().Type, TokenKind::EOF_);
+}
+
+TEST(Lexer, TestDecodeUtf8) {
+  struct Case {
+    std::string bytes;
+    char32_t codePoint;
+    std::size_t length;
+  };
+  std::vector<Case> cases = {
+      {"a", U'a', 1},
+      {"\xc3\xa9", U'é', 2},
+      {"\xe2\x82\xac", U'€', 3},
+      {"\xf0\x9f\x99\x82", U'\U0001f642', 4},
+      {"\x80", 0, 0},             // stray continuation byte
+      {"\xe2\x82", 0, 0},         // truncated
+      {"\xc0\xaf", 0, 0},         // overlong '/'
+      {"\xed\xa0\x80", 0, 0},     // surrogate
+      {"\xf4\x90\x80\x80", 0, 0}, // past U+10FFFF
+      {"\xff", 0, 0},
+  };
+  for (auto &&c : cases) {
+    DecodedChar decoded = decodeUtf8(c.bytes, 0);
+    EXPECT_EQ(decoded.length, c.length) << c.bytes;
+    if (c.length != 0) {
+      EXPECT_EQ(decoded.codePoint, c.codePoint) << c.bytes;
+    }
+  }
+  EXPECT_TRUE(isXidStart(U'λ'));
+  EXPECT_TRUE(isXidStart(U'数'));
+  EXPECT_FALSE(isXidStart(U'€'));
+  EXPECT_FALSE(isXidStart(U'×')); // multiplication sign
+  EXPECT_FALSE(isXidStart(U'\u0e34')); // Thai sara i, a combining mark
+  EXPECT_TRUE(isXidContinue(U'\u0e34'));
+  EXPECT_TRUE(isXidContinue(U'\u094d')); // Devanagari virama
+  EXPECT_FALSE(isXidContinue(U'€'));
+}
+
+TEST(Lexer, TestUnicodeIdentifiers) {
+  std::string input{"let größe = λ(x_ü) + 数据; \"ünï€\" € \xff a\xe2\x82"};
+
+  std::vector<TestToken> TestCases = {
+      {TokenKind::LET, "let"},          {TokenKind::IDENT, "größe"},
+      {TokenKind::ASSIGN, "="},         {TokenKind::IDENT, "λ"},
+      {TokenKind::LPAREN, "("},         {TokenKind::IDENT, "x_ü"},
+      {TokenKind::RPAREN, ")"},         {TokenKind::PLUS, "+"},
+      {TokenKind::IDENT, "数据"},       {TokenKind::SEMICOLON, ";"},
+      {TokenKind::STRING, "\"ünï€\""}, {TokenKind::ILLEGAL, "€"},
+      {TokenKind::ILLEGAL, "\xff"},     {TokenKind::IDENT, "a"},
+      {TokenKind::ILLEGAL, "\xe2"},     {TokenKind::ILLEGAL, "\x82"},
+      {TokenKind::EOF_, ""}};
+
+  Lexer l{input};
+  for (auto &&test : TestCases) {
+    Token token = l.nextToken();
+    EXPECT_EQ(token.Type, test.expectedType) << test.expectedLiteral;
+    EXPECT_EQ(token.Literal, test.expectedLiteral);
+  }
+
+  // Whole words of scripts whose letters combine with marks or have their
+  // own length mark; a mark alone cannot start an identifier.
+  std::string words{"เงิน हिन्दी コーヒー x\u0301 \u0301x"};
+  std::vector<TestToken> WordCases = {
+      {TokenKind::IDENT, "เงิน"},     {TokenKind::IDENT, "हिन्दी"},
+      {TokenKind::IDENT, "コーヒー"}, {TokenKind::IDENT, "x\u0301"},
+      {TokenKind::ILLEGAL, "\u0301"}, {TokenKind::IDENT, "x"},
+      {TokenKind::EOF_, ""}};
+
+  Lexer wordLexer{words};
+  for (auto &&test : WordCases) {
+    Token token = wordLexer.nextToken();
+    EXPECT_EQ(token.Type, test.expectedType) << test.expectedLiteral;
+    EXPECT_EQ(token.Literal, test.expectedLiteral);
+  }
+}
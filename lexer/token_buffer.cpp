@@ -0,0 +1,286 @@
+#include "token_buffer.hpp"
+#include "../token/token.hpp"
+#include "lexer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+bool isBracket(TokenKind kind) {
+  return kind == TokenKind::LPAREN || kind == TokenKind::RPAREN ||
+         kind == TokenKind::LBRACE || kind == TokenKind::RBRACE;
+}
+
+} // namespace
+
+TokenBuffer::TokenBuffer()
+    : kinds{}, starts{}, lengths{}, matches{}, gapStart{}, gapSize{},
+      tailEnd{}, source{} {}
+
+void TokenBuffer::moveGap(std::size_t i) {
+  if (i == gapStart) {
+    return;
+  }
+  if (gapStart == size()) {
+    // Nothing is past the gap yet; any end at or after every start will do
+    tailEnd = size() == 0 ? 0 : end(size() - 1);
+  }
+  std::size_t g = gapSize;
+  bool matched = matches.size() == kinds.size();
+  // Tokens crossing the gap switch between counting from the front and from
+  // tailEnd. The partner of a bracket that moved is told its new slot; a
+  // partner that moved too is recognised by its old slot.
+  if (i < gapStart) {
+    for (std::size_t k = gapStart; k-- > i;) {
+      kinds[k + g] = kinds[k];
+      starts[k + g] = tailEnd - starts[k];
+      lengths[k + g] = lengths[k];
+      if (matched) {
+        matches[k + g] = matches[k];
+      }
+    }
+    for (std::size_t k = i + g; matched && k < gapStart + g; ++k) {
+      std::uint32_t partner = matches[k];
+      if (partner == noMatch) {
+        continue;
+      }
+      if (partner >= i && partner < gapStart) {
+        matches[k] = static_cast<std::uint32_t>(partner + g);
+      } else {
+        matches[partner] = static_cast<std::uint32_t>(k);
+      }
+    }
+  } else {
+    for (std::size_t k = gapStart; k < i; ++k) {
+      kinds[k] = kinds[k + g];
+      starts[k] = tailEnd - starts[k + g];
+      lengths[k] = lengths[k + g];
+      if (matched) {
+        matches[k] = matches[k + g];
+      }
+    }
+    for (std::size_t k = gapStart; matched && k < i; ++k) {
+      std::uint32_t partner = matches[k];
+      if (partner == noMatch) {
+        continue;
+      }
+      if (partner >= gapStart + g && partner < i + g) {
+        matches[k] = static_cast<std::uint32_t>(partner - g);
+      } else {
+        matches[partner] = static_cast<std::uint32_t>(k);
+      }
+    }
+  }
+  gapStart = i;
+}
+
+void TokenBuffer::reserveGap(std::size_t n) {
+  if (gapSize >= n) {
+    return;
+  }
+  std::size_t grow = n - gapSize + size() / 8 + 16;
+  std::size_t tail = gapStart + gapSize;
+  kinds.insert(kinds.begin() + tail, grow, TokenKind::ILLEGAL);
+  starts.insert(starts.begin() + tail, grow, 0);
+  lengths.insert(lengths.begin() + tail, grow, 0);
+  if (matches.size() + grow == kinds.size()) {
+    matches.insert(matches.begin() + tail, grow, noMatch);
+    for (std::uint32_t &partner : matches) {
+      if (partner != noMatch && partner >= tail) {
+        partner = static_cast<std::uint32_t>(partner + grow);
+      }
+    }
+  }
+  gapSize += grow;
+}
+
+void TokenBuffer::closeGap() {
+  if (gapStart == kinds.size()) {
+    return;
+  }
+  bool matched = matches.size() == kinds.size();
+  moveGap(size());
+  kinds.resize(gapStart);
+  starts.resize(gapStart);
+  lengths.resize(gapStart);
+  if (matched) {
+    matches.resize(gapStart);
+  }
+  gapSize = 0;
+}
+
+void TokenBuffer::reserve(std::size_t n) {
+  kinds.reserve(n + gapSize);
+  starts.reserve(n + gapSize);
+  lengths.reserve(n + gapSize);
+}
+
+void TokenBuffer::push(TokenKind kind, std::uint32_t start,
+                       std::uint32_t length) {
+  if (gapStart != kinds.size()) {
+    closeGap();
+  }
+  kinds.push_back(kind);
+  starts.push_back(start);
+  lengths.push_back(length);
+  gapStart = kinds.size();
+}
+
+std::size_t TokenBuffer::firstUnbalanced() const {
+  for (std::size_t i = 0; i < size(); ++i) {
+    if (isBracket(kind(i)) && match(i) == noMatch) {
+      return i;
+    }
+  }
+  return size();
+}
+
+void TokenBuffer::computeMatches() {
+  matches.assign(kinds.size(), noMatch);
+  std::vector<std::uint32_t> open{};
+  for (std::size_t i = 0; i < size(); ++i) {
+    auto at = static_cast<std::uint32_t>(slot(i));
+    TokenKind opener;
+    switch (kinds[at]) {
+    case TokenKind::LPAREN:
+    case TokenKind::LBRACE:
+      open.push_back(at);
+      continue;
+    case TokenKind::RPAREN:
+      opener = TokenKind::LPAREN;
+      break;
+    case TokenKind::RBRACE:
+      opener = TokenKind::LBRACE;
+      break;
+    default:
+      continue;
+    }
+    if (!open.empty() && kinds[open.back()] == opener) {
+      matches[open.back()] = at;
+      matches[at] = open.back();
+      open.pop_back();
+    }
+  }
+}
+
+void TokenBuffer::append(const TokenBuffer &other, std::size_t from) {
+  closeGap();
+  if (other.gapStart != other.kinds.size()) {
+    for (std::size_t i = from; i < other.size(); ++i) {
+      push(other.kind(i), other.start(i), other.length(i));
+    }
+    return;
+  }
+  kinds.insert(kinds.end(), other.kinds.begin() + from, other.kinds.end());
+  starts.insert(starts.end(), other.starts.begin() + from, other.starts.end());
+  lengths.insert(lengths.end(), other.lengths.begin() + from,
+                 other.lengths.end());
+  gapStart = kinds.size();
+}
+
+void TokenBuffer::replace(std::size_t first, std::size_t last,
+                          const TokenBuffer &fresh, std::int64_t shift) {
+  if (matches.size() != kinds.size()) {
+    computeMatches();
+  }
+  std::size_t removed = last - first;
+  std::size_t inserted = fresh.size();
+  moveGap(first);
+  if (inserted > removed) {
+    reserveGap(inserted - removed);
+  }
+  // The removed tokens now fill the slots right after the gap
+  std::size_t old = first + gapSize;
+
+  // When the edit left the sequence of bracket kinds alone they pair up as
+  // before: the k-th bracket of fresh takes over from the k-th removed one.
+  std::vector<std::uint32_t> successor(removed, noMatch);
+  bool local = true;
+  std::size_t next = 0;
+  for (std::size_t k = 0; k < removed && local; ++k) {
+    if (!isBracket(kinds[old + k])) {
+      continue;
+    }
+    while (next < inserted && !isBracket(fresh.kind(next))) {
+      ++next;
+    }
+    local = next < inserted && fresh.kind(next) == kinds[old + k];
+    successor[k] = static_cast<std::uint32_t>(next++);
+  }
+  while (local && next < inserted && !isBracket(fresh.kind(next))) {
+    ++next;
+  }
+  local = local && next == inserted;
+
+  std::vector<std::uint32_t> freshMatches(inserted, noMatch);
+  // Brackets outside the edit and the slot of their new partner
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> outside{};
+  for (std::size_t k = 0; local && k < removed; ++k) {
+    std::uint32_t partner = matches[old + k];
+    if (successor[k] == noMatch || partner == noMatch) {
+      continue;
+    }
+    std::uint32_t &match = freshMatches[successor[k]];
+    if (partner >= old && partner < old + removed) {
+      match = static_cast<std::uint32_t>(first + successor[partner - old]);
+    } else {
+      match = partner;
+      outside.emplace_back(partner,
+                           static_cast<std::uint32_t>(first + successor[k]));
+    }
+  }
+
+  // The fresh tokens go at the front of the gap; removed ones join it
+  for (std::size_t j = 0; j < inserted; ++j) {
+    kinds[first + j] = fresh.kind(j);
+    starts[first + j] = fresh.start(j);
+    lengths[first + j] = fresh.length(j);
+    matches[first + j] = freshMatches[j];
+  }
+  for (auto [partner, at] : outside) {
+    matches[partner] = at;
+  }
+  gapStart = first + inserted;
+  gapSize = gapSize + removed - inserted;
+  tailEnd = static_cast<std::uint32_t>(tailEnd + shift);
+
+  if (!local) {
+    computeMatches();
+  }
+}
+
+TokenBuffer tokenize(std::string_view source) {
+  if (source.size() > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("tokenize: source larger than 4 GiB");
+  }
+
+  TokenBuffer tokens{};
+  tokens.source = source;
+  // Typical Monkey code averages about 3 bytes per token; reserving for 2
+  // avoids regrowing the arrays in the middle of the loop.
+  tokens.reserve(source.size() / 2 + 1);
+
+  Lexer l{source};
+  Token token{};
+  do {
+    token = l.nextToken();
+    std::size_t start = token.Literal.data() - source.data();
+    tokens.push(token.Type, static_cast<std::uint32_t>(start),
+                static_cast<std::uint32_t>(token.Literal.size()));
+  } while (token.Type != TokenKind::EOF_);
+  tokens.computeMatches();
+  return tokens;
+}
+
+Token TokenBufferReader::nextToken() {
+  Token token = tokens.token(next);
+  if (next + 1 < tokens.size()) {
+    ++next;
+  }
+  return token;
+}
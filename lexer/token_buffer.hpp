@@ -0,0 +1,169 @@
+#pragma once
+#include "../token/token.hpp"
+#include "token_source.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Result of TokenBuffer::match for a token that is not a bracket, or a
+// bracket without a partner.
+constexpr std::uint32_t noMatch = ~std::uint32_t{0};
+
+// A whole token stream stored as parallel arrays: one byte of kind, two 32 bit
+// integers locating the literal in the source and one holding the index of
+// the matching bracket, 13 bytes per token. The last token is always EOF.
+// Like Token, it views the source without owning it.
+//
+// So that relex() can replace a few tokens in the middle without moving all
+// the ones after them, the arrays are a gap buffer: after an edit they hold
+// unused slots where the edit was. Tokens past the gap store their start
+// counted back from tailEnd and their partner bracket as a slot, so an edit
+// that changes the length of the source or the number of tokens leaves them
+// alone. Only moving the gap to the next edit touches the tokens in between.
+class TokenBuffer {
+private:
+  std::vector<TokenKind> kinds;
+  std::vector<std::uint32_t> starts;
+  std::vector<std::uint32_t> lengths;
+  // For every "(" and "{" the slot of its ")" or "}" and the other way
+  // round, noMatch for anything else.
+  std::vector<std::uint32_t> matches;
+  std::size_t gapStart;
+  std::size_t gapSize;
+  // Tokens past the gap start this many bytes before tailEnd
+  std::uint32_t tailEnd;
+
+  std::size_t slot(std::size_t i) const {
+    return i < gapStart ? i : i + gapSize;
+  }
+  std::uint32_t index(std::uint32_t at) const {
+    return at < gapStart ? at : static_cast<std::uint32_t>(at - gapSize);
+  }
+
+  // Moves the gap to just before token i. Costs one pass over the tokens
+  // between the old and the new place.
+  void moveGap(std::size_t i);
+
+  // Makes the gap at least n slots wide, growing it in proportion to the
+  // whole buffer so that a run of edits regrows it only now and then.
+  void reserveGap(std::size_t n);
+
+  // Moves the gap to the end and drops it, so tokens can be appended.
+  void closeGap();
+
+public:
+  std::string_view source;
+
+  // Bytes the columns take per token, gap and spare capacity aside
+  static constexpr std::size_t bytesPerToken =
+      sizeof(decltype(kinds)::value_type) +
+      sizeof(decltype(starts)::value_type) +
+      sizeof(decltype(lengths)::value_type) +
+      sizeof(decltype(matches)::value_type);
+
+  TokenBuffer();
+
+  std::size_t size() const { return kinds.size() - gapSize; }
+
+  TokenKind kind(std::size_t i) const { return kinds[slot(i)]; }
+
+  // Byte offset of token i in the source.
+  std::uint32_t start(std::size_t i) const {
+    return i < gapStart ? starts[i] : tailEnd - starts[i + gapSize];
+  }
+
+  std::uint32_t length(std::size_t i) const { return lengths[slot(i)]; }
+
+  // Byte offset just past token i.
+  std::uint32_t end(std::size_t i) const { return start(i) + length(i); }
+
+  // For a "(" or "{" the index of its ")" or "}" and the other way round,
+  // noMatch for anything else. Lets a consumer step over a whole
+  // parenthesised expression or block without looking at its tokens.
+  std::uint32_t match(std::size_t i) const {
+    std::uint32_t partner = matches[slot(i)];
+    return partner == noMatch ? noMatch : index(partner);
+  }
+
+  std::string_view literal(std::size_t i) const {
+    return source.substr(start(i), length(i));
+  }
+
+  Token token(std::size_t i) const {
+    Token token{kind(i), literal(i), start(i)};
+    if (token.Type == TokenKind::INT) {
+      token.Value = integerLiteralValue(token.Literal);
+    } else if (token.Type == TokenKind::FLOAT) {
+      token.FloatValue = floatLiteralValue(token.Literal);
+    } else if (token.Type == TokenKind::STRING) {
+      token.HasEscapes =
+          stringLiteralBody(token.Literal).find('\\') != std::string_view::npos;
+    }
+    return token;
+  }
+
+  // Index of the first bracket without a partner, or size() if every "(" and
+  // "{" is closed by the right kind of bracket.
+  std::size_t firstUnbalanced() const;
+
+  // Fills the matches with one pass over a stack of open brackets. A closing
+  // bracket that does not match the innermost open one is left unmatched and
+  // does not close it.
+  void computeMatches();
+
+  // Room for n tokens in all, so that push() does not regrow the arrays.
+  void reserve(std::size_t n);
+
+  // Appends a token. Leaves the matches alone, so computeMatches() has to run
+  // once all tokens are in.
+  void push(TokenKind kind, std::uint32_t start, std::uint32_t length);
+
+  // Appends tokens [from, other.size()) of a buffer over the same source.
+  void append(const TokenBuffer &other, std::size_t from);
+
+  // Replaces tokens [first, last) with all of fresh, whose offsets are
+  // already those of the edited source, and moves the tokens from last on by
+  // shift bytes. Brackets are matched again only where the edit was, unless
+  // it changed which brackets there are; then the whole stream is.
+  void replace(std::size_t first, std::size_t last, const TokenBuffer &fresh,
+               std::int64_t shift);
+};
+
+// Lexes all of source in one pass and matches its brackets. Sources must be
+// smaller than 4 GiB.
+TokenBuffer tokenize(std::string_view source);
+
+// Lexes source on up to `threads` threads (never more than the machine has
+// cores). The input is cut by chunkBoundaries into one chunk per thread and
+// the chunk streams are stitched together; the result is always identical to
+// tokenize(source).
+TokenBuffer tokenizeParallel(std::string_view source, unsigned threads);
+
+// Boundaries for tokenizeChunks that cut source into `chunks` pieces of about
+// the same size. Each cut is moved forward to a newline that a scan from the
+// start of an earlier line finds outside strings and comments, so that a
+// chunk starts where a sequential lexer would be between tokens. Lines nearly
+// always start outside strings and comments; where that guess is wrong the
+// stitching still gives the right tokens, only more slowly.
+std::vector<std::size_t> chunkBoundaries(std::string_view source,
+                                         std::size_t chunks);
+
+// Lexes each [boundaries[i], boundaries[i + 1]) range on its own thread and
+// stitches the results. Boundaries must be sorted, start at 0 and end at
+// source.size(); they may fall anywhere, even inside a token, at the cost of
+// re-lexing the tokens around that boundary sequentially.
+TokenBuffer tokenizeChunks(std::string_view source,
+                           const std::vector<std::size_t> &boundaries);
+
+// Replays a TokenBuffer as a TokenSource so it can be handed to the Parser.
+class TokenBufferReader : public TokenSource {
+private:
+  const TokenBuffer &tokens;
+  std::size_t next;
+
+public:
+  TokenBufferReader(const TokenBuffer &t) : tokens{t}, next{} {};
+
+  Token nextToken() override;
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include "../token/token.hpp"
+
+// Anything the Parser can pull tokens from. Once the input is exhausted a
+// source keeps returning EOF tokens.
+class TokenSource {
+public:
+  virtual Token nextToken() = 0;
+  virtual ~TokenSource() = default;
+};
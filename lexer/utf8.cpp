@@ -0,0 +1,110 @@
+#include "utf8.hpp"
+#include "xid_ranges.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+namespace {
+
+template <std::size_t N>
+constexpr bool rangesSorted(const CodePointRange (&ranges)[N]) {
+  for (std::size_t i = 1; i < N; ++i) {
+    if (ranges[i - 1].last >= ranges[i].first ||
+        ranges[i].first > ranges[i].last) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(rangesSorted(xidStartRanges),
+              "xidStartRanges must be sorted and disjoint");
+static_assert(rangesSorted(xidContinueRanges),
+              "xidContinueRanges must be sorted and disjoint");
+
+// Binary search for the range holding codePoint.
+template <std::size_t N>
+bool inRanges(const CodePointRange (&ranges)[N], char32_t codePoint) {
+  auto range = std::upper_bound(
+      std::begin(ranges), std::end(ranges), codePoint,
+      [](char32_t c, const CodePointRange &r) { return c < r.first; });
+  if (range == std::begin(ranges)) {
+    return false;
+  }
+  --range;
+  return codePoint <= range->last;
+}
+
+bool isContinuation(unsigned char byte) { return (byte & 0xC0) == 0x80; }
+
+} // namespace
+
+DecodedChar decodeUtf8(std::string_view input, std::size_t pos) {
+  const DecodedChar invalid{0, 0};
+  if (pos >= input.size()) {
+    return invalid;
+  }
+  unsigned char lead = static_cast<unsigned char>(input[pos]);
+  if (lead < 0x80) {
+    return DecodedChar{lead, 1};
+  }
+
+  std::size_t length;
+  char32_t codePoint;
+  char32_t minimum;
+  if ((lead & 0xE0) == 0xC0) {
+    length = 2;
+    codePoint = lead & 0x1F;
+    minimum = 0x80;
+  } else if ((lead & 0xF0) == 0xE0) {
+    length = 3;
+    codePoint = lead & 0x0F;
+    minimum = 0x800;
+  } else if ((lead & 0xF8) == 0xF0) {
+    length = 4;
+    codePoint = lead & 0x07;
+    minimum = 0x10000;
+  } else {
+    return invalid;
+  }
+  if (input.size() - pos < length) {
+    return invalid;
+  }
+  for (std::size_t i = 1; i < length; ++i) {
+    unsigned char byte = static_cast<unsigned char>(input[pos + i]);
+    if (!isContinuation(byte)) {
+      return invalid;
+    }
+    codePoint = (codePoint << 6) | (byte & 0x3F);
+  }
+  if (codePoint < minimum || codePoint > 0x10FFFF ||
+      (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+    return invalid;
+  }
+  return DecodedChar{codePoint, length};
+}
+
+bool isXidStart(char32_t codePoint) {
+  return inRanges(xidStartRanges, codePoint);
+}
+
+bool isXidContinue(char32_t codePoint) {
+  return inRanges(xidContinueRanges, codePoint);
+}
+
+std::size_t identifierStartLength(std::string_view input, std::size_t pos) {
+  DecodedChar decoded = decodeUtf8(input, pos);
+  if (decoded.length < 2 || !isXidStart(decoded.codePoint)) {
+    return 0;
+  }
+  return decoded.length;
+}
+
+std::size_t identifierContinueLength(std::string_view input,
+                                     std::size_t pos) {
+  DecodedChar decoded = decodeUtf8(input, pos);
+  if (decoded.length < 2 || !isXidContinue(decoded.codePoint)) {
+    return 0;
+  }
+  return decoded.length;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// A code point decoded from UTF-8 and the number of bytes it took. length is
+// 0 for a malformed sequence: a stray continuation byte, a truncated
+// sequence, an overlong encoding, a surrogate or a value past U+10FFFF.
+struct DecodedChar {
+  char32_t codePoint;
+  std::size_t length;
+};
+
+DecodedChar decodeUtf8(std::string_view input, std::size_t pos);
+
+// True for the code points with the Unicode XID_Start property, the ones that
+// may start an identifier. The ranges are generated from the Unicode
+// character database into xid_ranges.hpp by gen_xid_ranges.py.
+bool isXidStart(char32_t codePoint);
+
+// True for XID_Continue: XID_Start plus combining marks (Thai vowels,
+// Devanagari matras and virama), digits and connectors, which may follow the
+// first charachter of an identifier.
+bool isXidContinue(char32_t codePoint);
+
+// Length of the UTF-8 encoded non-ASCII charachter at pos if it may start an
+// identifier, 0 if it may not.
+std::size_t identifierStartLength(std::string_view input, std::size_t pos);
+
+// Length of the UTF-8 encoded non-ASCII charachter at pos if it may continue
+// an identifier, 0 if it may not.
+std::size_t identifierContinueLength(std::string_view input, std::size_t pos);
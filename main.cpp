@@ -1,4 +1,15 @@
 #include "repl/repl.hpp"
 #include <cstdio>
 #include <iostream>
-int main(int argc, char *argv[]) { Start(std::cin, std::cout); }
+#include <string>
+int main(int argc, char *argv[]) {
+  // monkey <script> parses a file, plain monkey starts the REPL.
+  // monkey --token-cache <script> also keeps the script's tokens on disk.
+  if (argc > 2 && std::string(argv[1]) == "--token-cache") {
+    return RunFile(argv[2], std::cout, true);
+  }
+  if (argc > 1) {
+    return RunFile(argv[1], std::cout);
+  }
+  Start(std::cin, std::cout);
+}
@@ -1,7 +1,14 @@
 #include "parser.hpp"
+#include "../ast/arena.hpp"
 #include "../ast/ast.hpp"
 #include "../lexer/lexer.hpp"
+#include "../lexer/line_table.hpp"
+#include "../token/interner.hpp"
 #include "../token/token.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -22,71 +29,118 @@ enum class Precedence {
   INDEX,
 };
 
-Parser::Parser(Lexer *l)
-    : lexer{l}, errors{}, prefixParseFns{}, infixParseFns{} {
+namespace {
+
+struct PrefixRule {
+  TokenKind kind;
+  prefixParseFn fn;
+};
+
+// Adding a prefix operator or a new kind of literal means adding a row here.
+constexpr PrefixRule prefixRules[] = {
+    {TokenKind::IDENT, &Parser::parseIdentifier},
+    {TokenKind::INT, &Parser::parseIntegerLiteral},
+    {TokenKind::FLOAT, &Parser::parseFloatLiteral},
+    {TokenKind::STRING, &Parser::parseStringLiteral},
+    {TokenKind::BANG, &Parser::parsePrefixExpression},
+    {TokenKind::MINUS, &Parser::parsePrefixExpression},
+    {TokenKind::TRUE, &Parser::parseBoolean},
+    {TokenKind::FALSE, &Parser::parseBoolean},
+    {TokenKind::LPAREN, &Parser::parseGroupedExpression},
+    {TokenKind::IF, &Parser::parseIfExpression},
+    {TokenKind::FUNCTION, &Parser::parseFunctionLiteral},
+};
+
+struct InfixRule {
+  TokenKind kind;
+  infixParseFn fn;
+};
+
+constexpr InfixRule infixRules[] = {
+    {TokenKind::PLUS, &Parser::parseInfixExpression},
+    {TokenKind::MINUS, &Parser::parseInfixExpression},
+    {TokenKind::SLASH, &Parser::parseInfixExpression},
+    {TokenKind::ASTERISK, &Parser::parseInfixExpression},
+    {TokenKind::EQ, &Parser::parseInfixExpression},
+    {TokenKind::NOT_EQ, &Parser::parseInfixExpression},
+    {TokenKind::LT, &Parser::parseInfixExpression},
+    {TokenKind::GT, &Parser::parseInfixExpression},
+    {TokenKind::LPAREN, &Parser::parseCallExpression},
+};
+
+// Indexed by TokenKind, null for a kind without a parse function, so
+// dispatch is one load instead of a hash lookup.
+template <typename Fn, typename Rule, std::size_t N>
+constexpr std::array<Fn, tokenKindCount>
+buildParseTable(const Rule (&rules)[N]) {
+  std::array<Fn, tokenKindCount> table{};
+  for (auto &&rule : rules) {
+    table[static_cast<std::size_t>(rule.kind)] = rule.fn;
+  }
+  return table;
+}
+
+constexpr std::array<prefixParseFn, tokenKindCount> prefixParseFns =
+    buildParseTable<prefixParseFn>(prefixRules);
+constexpr std::array<infixParseFn, tokenKindCount> infixParseFns =
+    buildParseTable<infixParseFn>(infixRules);
+
+struct PrecedenceRule {
+  TokenKind kind;
+  Precedence precedence;
+};
+
+constexpr PrecedenceRule precedenceRules[] = {
+    {TokenKind::EQ, Precedence::EQUALS},
+    {TokenKind::NOT_EQ, Precedence::EQUALS},
+    {TokenKind::LT, Precedence::LESSGREATER},
+    {TokenKind::GT, Precedence::LESSGREATER},
+    {TokenKind::PLUS, Precedence::SUM},
+    {TokenKind::MINUS, Precedence::SUM},
+    {TokenKind::SLASH, Precedence::PRODUCT},
+    {TokenKind::ASTERISK, Precedence::PRODUCT},
+    {TokenKind::LPAREN, Precedence::CALL},
+    {TokenKind::LBRACE, Precedence::INDEX},
+};
+
+// Precedence of every TokenKind as an infix operator, LOWEST for the rest.
+constexpr std::array<Precedence, tokenKindCount> buildPrecedences() {
+  std::array<Precedence, tokenKindCount> table{};
+  for (auto &precedence : table) {
+    precedence = Precedence::LOWEST;
+  }
+  for (auto &&rule : precedenceRules) {
+    table[static_cast<std::size_t>(rule.kind)] = rule.precedence;
+  }
+  return table;
+}
+
+constexpr std::array<Precedence, tokenKindCount> precedences =
+    buildPrecedences();
+
+constexpr Precedence precedenceOf(TokenKind kind) {
+  return precedences[static_cast<std::size_t>(kind)];
+}
+
+static_assert(precedenceOf(TokenKind::ASTERISK) > precedenceOf(TokenKind::PLUS),
+              "products have to bind tighter than sums");
+
+prefixParseFn prefixParseFnFor(TokenKind kind) {
+  return prefixParseFns[static_cast<std::size_t>(kind)];
+}
+
+infixParseFn infixParseFnFor(TokenKind kind) {
+  return infixParseFns[static_cast<std::size_t>(kind)];
+}
+
+} // namespace
+
+Parser::Parser(TokenSource *l, Interner *s)
+    : lexer{l}, ownSymbols{}, symbols{s != nullptr ? s : &ownSymbols},
+      errors{}, errorOffsets{} {
   // Read 2 tokens
   nextToken();
   nextToken();
-
-  precedences = {
-      {std::string(TokenTypes::EQ), Precedence::EQUALS},
-      {std::string(TokenTypes::NOT_EQ), Precedence::EQUALS},
-      {std::string(TokenTypes::LT), Precedence::LESSGREATER},
-      {std::string(TokenTypes::GT), Precedence::LESSGREATER},
-      {std::string(TokenTypes::PLUS), Precedence::SUM},
-      {std::string(TokenTypes::MINUS), Precedence::SUM},
-      {std::string(TokenTypes::SLASH), Precedence::PRODUCT},
-      {std::string(TokenTypes::ASTERISK), Precedence::PRODUCT},
-      {std::string(TokenTypes::LPAREN), Precedence::CALL},
-      {std::string(TokenTypes::LBRACE), Precedence::INDEX},
-  };
-
-  registerPrefix(std::string(TokenTypes::IDENT),
-                 std::bind(&Parser::parseIdentifier, this));
-  registerPrefix(std::string(TokenTypes::INT),
-                 std::bind(&Parser::parseIntegerLiteral, this));
-  registerPrefix(std::string(TokenTypes::BANG),
-                 std::bind(&Parser::parsePrefixExpression, this));
-  registerPrefix(std::string(TokenTypes::MINUS),
-                 std::bind(&Parser::parsePrefixExpression, this));
-  registerPrefix(std::string(TokenTypes::TRUE),
-                 std::bind(&Parser::parseBoolean, this));
-  registerPrefix(std::string(TokenTypes::FALSE),
-                 std::bind(&Parser::parseBoolean, this));
-  registerPrefix(std::string(TokenTypes::LPAREN),
-                 std::bind(&Parser::parseGroupedExpression, this));
-  registerPrefix(std::string(TokenTypes::IF),
-                 std::bind(&Parser::parseIfExpression, this));
-  registerPrefix(std::string(TokenTypes::FUNCTION),
-                 std::bind(&Parser::parseFunctionLiteral, this));
-
-  registerInfix(
-      std::string(TokenTypes::PLUS),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::MINUS),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::SLASH),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::ASTERISK),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::EQ),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::NOT_EQ),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::LT),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::GT),
-      std::bind(&Parser::parseInfixExpression, this, std::placeholders::_1));
-  registerInfix(
-      std::string(TokenTypes::LPAREN),
-      std::bind(&Parser::parseCallExpression, this, std::placeholders::_1));
 }
 
 void Parser::nextToken() {
@@ -98,13 +152,13 @@ std::unique_ptr<LetStatement> Parser::parseLetStatement() {
   std::unique_ptr<LetStatement> stmt =
       std::make_unique<LetStatement>(CurrentToken);
 
-  if (!expectPeek(TokenTypes::IDENT)) {
+  if (!expectPeek(TokenKind::IDENT)) {
     return nullptr;
   }
 
-  stmt->name = std::make_unique<Identifier>(CurrentToken, CurrentToken.Literal);
+  stmt->name = makeIdentifier();
 
-  if (!expectPeek(TokenTypes::ASSIGN)) {
+  if (!expectPeek(TokenKind::ASSIGN)) {
     return nullptr;
   }
 
@@ -112,7 +166,7 @@ std::unique_ptr<LetStatement> Parser::parseLetStatement() {
 
   stmt->value = std::move(parseExpression(Precedence::LOWEST));
 
-  if (peekTokenIs(TokenTypes::SEMICOLON)) {
+  if (peekTokenIs(TokenKind::SEMICOLON)) {
     nextToken();
   }
   return std::move(stmt);
@@ -126,7 +180,7 @@ std::unique_ptr<ReturnStatement> Parser::parseReturnStatement() {
 
   stmt->returnValue = std::move(parseExpression(Precedence::LOWEST));
 
-  if (peekTokenIs(TokenTypes::SEMICOLON)) {
+  if (peekTokenIs(TokenKind::SEMICOLON)) {
     nextToken();
   }
 
@@ -134,9 +188,9 @@ std::unique_ptr<ReturnStatement> Parser::parseReturnStatement() {
 }
 
 std::unique_ptr<Statement> Parser::parseStatement() {
-  if (CurrentToken.Type == TokenTypes::LET) {
+  if (CurrentToken.Type == TokenKind::LET) {
     return std::move(parseLetStatement());
-  } else if (CurrentToken.Type == TokenTypes::RETURN) {
+  } else if (CurrentToken.Type == TokenKind::RETURN) {
     return std::move(parseReturnStatement());
   } else {
     return std::move(parseExpressionStatement());
@@ -147,7 +201,7 @@ std::unique_ptr<Program> Parser::parseProgram() {
   std::unique_ptr<Program> program = std::make_unique<Program>();
   program->statements = std::vector<std::unique_ptr<Statement>>{};
 
-  while (!curTokenIs(TokenTypes::EOF_)) {
+  while (!curTokenIs(TokenKind::EOF_)) {
     std::unique_ptr<Statement> stmt = parseStatement();
     if (stmt != nullptr) {
       program->statements.push_back(std::move(stmt));
@@ -157,15 +211,23 @@ std::unique_ptr<Program> Parser::parseProgram() {
   return std::move(program);
 }
 
-bool Parser::curTokenIs(std::string_view &type) {
+ParseResult Parser::parseProgramInArena() {
+  ParseResult result{};
+  result.arena = std::make_unique<Arena>();
+  ArenaScope scope{*result.arena};
+  result.program = parseProgram();
+  return result;
+}
+
+bool Parser::curTokenIs(TokenKind type) {
   return CurrentToken.Type == type;
 }
 
-bool Parser::peekTokenIs(std::string_view &type) {
+bool Parser::peekTokenIs(TokenKind type) {
   return peekToken.Type == type;
 }
 
-bool Parser::expectPeek(std::string_view &type) {
+bool Parser::expectPeek(TokenKind type) {
   if (peekTokenIs(type)) {
     nextToken();
     return true;
@@ -177,77 +239,116 @@ bool Parser::expectPeek(std::string_view &type) {
 
 std::vector<std::string> &Parser::getErrors() { return errors; }
 
-void Parser::PeekError(std::string_view &t) {
-  std::string msg =
-      "Expected next token to be: " + std::string(t) + "got: " + peekToken.Type;
-  errors.push_back(msg);
+Interner &Parser::getSymbols() { return *symbols; }
+
+std::vector<std::string> Parser::formatErrors(std::string_view name,
+                                              LineTable &lines) {
+  std::vector<std::string> formatted;
+  formatted.reserve(errors.size());
+  for (std::size_t i = 0; i < errors.size(); ++i) {
+    SourceLocation location = lines.locate(errorOffsets[i]);
+    formatted.push_back(std::string(name) + ":" +
+                        std::to_string(location.line) + ":" +
+                        std::to_string(location.column) + ": " + errors[i]);
+  }
+  return formatted;
 }
 
-void Parser::registerPrefix(TokenType_t tokenType, prefixParseFn fn) {
-  prefixParseFns[tokenType] = fn;
+void Parser::addError(std::uint32_t offset, std::string msg) {
+  errors.push_back(std::move(msg));
+  errorOffsets.push_back(offset);
 }
 
-void Parser::registerInfix(TokenType_t tokenType, infixParseFn fn) {
-  infixParseFns[tokenType] = fn;
+void Parser::PeekError(TokenKind t) {
+  std::string msg = "Expected next token to be: " +
+                    std::string(tokenKindName(t)) +
+                    "got: " + std::string(tokenKindName(peekToken.Type));
+  addError(peekToken.Offset, msg);
 }
 
 std::unique_ptr<ExpressionStatement> Parser::parseExpressionStatement() {
   std::unique_ptr<ExpressionStatement> stmt =
       std::make_unique<ExpressionStatement>(CurrentToken);
   stmt->expression = std::move(parseExpression(Precedence::LOWEST));
-  if (peekTokenIs(TokenTypes::SEMICOLON)) {
+  if (peekTokenIs(TokenKind::SEMICOLON)) {
     nextToken();
   }
   return std::move(stmt);
 }
 
 std::unique_ptr<Expression> Parser::parseExpression(Precedence precedence) {
-  if (!prefixParseFns.count(CurrentToken.Type)) {
+  prefixParseFn prefix = prefixParseFnFor(CurrentToken.Type);
+  if (prefix == nullptr) {
     noPrefixParseFnError(CurrentToken.Type);
     return nullptr;
   }
-  auto &&prefix = prefixParseFns[CurrentToken.Type];
 
-  std::unique_ptr<Expression> leftExp = prefix();
+  std::unique_ptr<Expression> leftExp = (this->*prefix)();
+  if (leftExp == nullptr) {
+    return nullptr;
+  }
 
-  while (!peekTokenIs(TokenTypes::SEMICOLON) && precedence < peekPrecedence()) {
-    if (!infixParseFns.count(peekToken.Type)) {
+  while (!peekTokenIs(TokenKind::SEMICOLON) && precedence < peekPrecedence()) {
+    infixParseFn infix = infixParseFnFor(peekToken.Type);
+    if (infix == nullptr) {
       return std::move(leftExp);
     }
 
-    auto &&infix = infixParseFns[peekToken.Type];
-
     nextToken();
 
-    leftExp = std::move(infix(std::move(leftExp)));
+    leftExp = std::move((this->*infix)(std::move(leftExp)));
   }
   return std::move(leftExp);
 }
 
-Precedence Parser::peekPrecedence() {
-  if (precedences.find(peekToken.Type) != precedences.end()) {
-    return precedences[peekToken.Type];
-  }
-  return Precedence::LOWEST;
-}
+Precedence Parser::peekPrecedence() { return precedenceOf(peekToken.Type); }
 
 std::unique_ptr<Expression> Parser::parseIdentifier() {
-  return std::move(
-      std::make_unique<Identifier>(CurrentToken, CurrentToken.Literal));
+  return makeIdentifier();
+}
+
+std::unique_ptr<Identifier> Parser::makeIdentifier() {
+  // Symbol shares a union with the values of other token kinds
+  SymbolId symbol =
+      CurrentToken.Type == TokenKind::IDENT ? CurrentToken.Symbol : noSymbol;
+  if (symbol == noSymbol) {
+    symbol = symbols->intern(CurrentToken.Literal);
+  }
+  return std::make_unique<Identifier>(CurrentToken, symbol);
 }
 
 std::unique_ptr<Expression> Parser::parseIntegerLiteral() {
-  int value = std::stoi(CurrentToken.Literal);
-  return std::move(std::make_unique<IntegerLiteral>(CurrentToken, value));
+  if (CurrentToken.Value == integerOverflow) {
+    addError(CurrentToken.Offset, "Integer literal " +
+                                      std::string(CurrentToken.Literal) +
+                                      " does not fit in 64 bits");
+    return nullptr;
+  }
+  return std::make_unique<IntegerLiteral>(CurrentToken, CurrentToken.Value);
+}
+
+std::unique_ptr<Expression> Parser::parseFloatLiteral() {
+  if (std::isinf(CurrentToken.FloatValue)) {
+    addError(CurrentToken.Offset, "Float literal " +
+                                      std::string(CurrentToken.Literal) +
+                                      " is too large for a double");
+    return nullptr;
+  }
+  return std::make_unique<FloatLiteral>(CurrentToken, CurrentToken.FloatValue);
+}
+
+std::unique_ptr<Expression> Parser::parseStringLiteral() {
+  return std::make_unique<StringLiteral>(CurrentToken);
 }
 
-void Parser::noPrefixParseFnError(TokenType_t t) {
-  std::string msg = "No prefix parse function for " + t;
-  errors.push_back(msg);
+void Parser::noPrefixParseFnError(TokenKind t) {
+  std::string msg =
+      "No prefix parse function for " + std::string(tokenKindName(t));
+  addError(CurrentToken.Offset, msg);
 }
 
 std::unique_ptr<Expression> Parser::parsePrefixExpression() {
-  std::string operator_ = CurrentToken.Literal;
+  std::string operator_{CurrentToken.Literal};
 
   nextToken();
 
@@ -257,16 +358,11 @@ std::unique_ptr<Expression> Parser::parsePrefixExpression() {
                                                       std::move(right)));
 }
 
-Precedence Parser::curPrecedence() {
-  if (precedences.find(CurrentToken.Type) != precedences.end()) {
-    return precedences[CurrentToken.Type];
-  }
-  return Precedence::LOWEST;
-}
+Precedence Parser::curPrecedence() { return precedenceOf(CurrentToken.Type); }
 
 std::unique_ptr<Expression>
 Parser::parseInfixExpression(std::unique_ptr<Expression> leftExpr) {
-  std::string operator_ = CurrentToken.Literal;
+  std::string operator_{CurrentToken.Literal};
 
   Precedence precedence = curPrecedence();
   nextToken();
@@ -278,7 +374,7 @@ Parser::parseInfixExpression(std::unique_ptr<Expression> leftExpr) {
 
 std::unique_ptr<Expression> Parser::parseBoolean() {
   return std::move(
-      std::make_unique<Boolean>(CurrentToken, curTokenIs(TokenTypes::TRUE)));
+      std::make_unique<Boolean>(CurrentToken, curTokenIs(TokenKind::TRUE)));
 }
 
 std::unique_ptr<Expression> Parser::parseGroupedExpression() {
@@ -286,7 +382,7 @@ std::unique_ptr<Expression> Parser::parseGroupedExpression() {
 
   std::unique_ptr<Expression> exp = parseExpression(Precedence::LOWEST);
 
-  if (!expectPeek(TokenTypes::RPAREN)) {
+  if (!expectPeek(TokenKind::RPAREN)) {
     return nullptr;
   }
 
@@ -297,7 +393,7 @@ std::unique_ptr<Expression> Parser::parseIfExpression() {
   std::unique_ptr<IfExpression> exp =
       std::make_unique<IfExpression>(CurrentToken);
 
-  if (!expectPeek(TokenTypes::LPAREN)) {
+  if (!expectPeek(TokenKind::LPAREN)) {
     return nullptr;
   }
 
@@ -305,19 +401,19 @@ std::unique_ptr<Expression> Parser::parseIfExpression() {
 
   exp->condition = std::move(parseExpression(Precedence::LOWEST));
 
-  if (!expectPeek(TokenTypes::RPAREN)) {
+  if (!expectPeek(TokenKind::RPAREN)) {
     return nullptr;
   }
 
-  if (!expectPeek(TokenTypes::LBRACE)) {
+  if (!expectPeek(TokenKind::LBRACE)) {
     return nullptr;
   }
   exp->consequence = std::move(parseBlockStatement());
 
-  if (peekTokenIs(TokenTypes::ELSE)) {
+  if (peekTokenIs(TokenKind::ELSE)) {
     nextToken();
 
-    if (!expectPeek(TokenTypes::LBRACE)) {
+    if (!expectPeek(TokenKind::LBRACE)) {
       return nullptr;
     }
 
@@ -332,7 +428,7 @@ std::unique_ptr<BlockStatement> Parser::parseBlockStatement() {
 
   nextToken();
 
-  while (!curTokenIs(TokenTypes::RBRACE) && !curTokenIs(TokenTypes::EOF_)) {
+  while (!curTokenIs(TokenKind::RBRACE) && !curTokenIs(TokenKind::EOF_)) {
     std::unique_ptr<Statement> stmt = parseStatement();
     if (stmt != nullptr) {
       block->statements.push_back(std::move(stmt));
@@ -346,13 +442,13 @@ std::unique_ptr<Expression> Parser::parseFunctionLiteral() {
   std::unique_ptr<FunctionLiteral> lit =
       std::make_unique<FunctionLiteral>(CurrentToken);
 
-  if (!expectPeek(TokenTypes::LPAREN)) {
+  if (!expectPeek(TokenKind::LPAREN)) {
     return nullptr;
   }
 
   lit->parameters = std::move(parseFunctionParameters());
 
-  if (!expectPeek(TokenTypes::LBRACE)) {
+  if (!expectPeek(TokenKind::LBRACE)) {
     return nullptr;
   }
 
@@ -364,26 +460,28 @@ std::unique_ptr<Expression> Parser::parseFunctionLiteral() {
 std::vector<std::unique_ptr<Identifier>> Parser::parseFunctionParameters() {
   std::vector<std::unique_ptr<Identifier>> identifiers;
 
-  if (peekTokenIs(TokenTypes::RPAREN)) {
+  if (peekTokenIs(TokenKind::RPAREN)) {
     nextToken();
     return identifiers;
   }
 
-  nextToken();
+  if (!expectPeek(TokenKind::IDENT)) {
+    return {};
+  }
 
-  std::unique_ptr<Identifier> ident =
-      std::make_unique<Identifier>(CurrentToken, CurrentToken.Literal);
+  std::unique_ptr<Identifier> ident = makeIdentifier();
   identifiers.push_back(std::move(ident));
 
-  while (peekTokenIs(TokenTypes::COMMA)) {
-    nextToken();
+  while (peekTokenIs(TokenKind::COMMA)) {
     nextToken();
-    std::unique_ptr<Identifier> ident =
-        std::make_unique<Identifier>(CurrentToken, CurrentToken.Literal);
+    if (!expectPeek(TokenKind::IDENT)) {
+      return {};
+    }
+    std::unique_ptr<Identifier> ident = makeIdentifier();
     identifiers.push_back(std::move(ident));
   }
 
-  if (!expectPeek(TokenTypes::RPAREN)) {
+  if (!expectPeek(TokenKind::RPAREN)) {
     return {};
   }
 
@@ -401,7 +499,7 @@ Parser::parseCallExpression(std::unique_ptr<Expression> fn) {
 std::vector<std::unique_ptr<Expression>> Parser::parseCallArguments() {
   std::vector<std::unique_ptr<Expression>> args;
 
-  if (peekTokenIs(TokenTypes::RPAREN)) {
+  if (peekTokenIs(TokenKind::RPAREN)) {
     nextToken();
     return std::move(args);
   }
@@ -409,13 +507,13 @@ std::vector<std::unique_ptr<Expression>> Parser::parseCallArguments() {
   nextToken();
   args.push_back(std::move(parseExpression(Precedence::LOWEST)));
 
-  while (peekTokenIs(TokenTypes::COMMA)) {
+  while (peekTokenIs(TokenKind::COMMA)) {
     nextToken();
     nextToken();
     args.push_back(std::move(parseExpression(Precedence::LOWEST)));
   }
 
-  if (!expectPeek(TokenTypes::RPAREN)) {
+  if (!expectPeek(TokenKind::RPAREN)) {
     return {};
   }
 
@@ -1,55 +1,95 @@
 #pragma once
+#include "../ast/arena.hpp"
 #include "../ast/ast.hpp"
 #include "../lexer/lexer.hpp"
+#include "../lexer/line_table.hpp"
+#include "../lexer/token_source.hpp"
+#include "../token/interner.hpp"
 #include "../token/token.hpp"
-#include <functional>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
-using prefixParseFn = std::function<std::unique_ptr<Expression>()>;
+// A Program whose nodes all live in an arena owned by the result. Destroying
+// it runs the node destructors but hands no node back to the heap; the arena
+// then drops its blocks, a handful even for a big program.
+struct ParseResult {
+  // Declared before program so that it is destroyed after it
+  std::unique_ptr<Arena> arena;
+  std::unique_ptr<Program> program;
+
+  ParseResult() = default;
+  ParseResult(ParseResult &&) = default;
+  // Drops the old program before the old arena it lives in
+  ParseResult &operator=(ParseResult &&other) noexcept {
+    program = std::move(other.program);
+    arena = std::move(other.arena);
+    return *this;
+  }
+};
+
+class Parser;
+
+// Pratt parsing functions. They are plain member function pointers, so the
+// tables of them in parser.cpp are built at compile time and shared by every
+// Parser.
+using prefixParseFn = std::unique_ptr<Expression> (Parser::*)();
 using infixParseFn =
-    std::function<std::unique_ptr<Expression>(std::unique_ptr<Expression>)>;
+    std::unique_ptr<Expression> (Parser::*)(std::unique_ptr<Expression>);
 
 enum class Precedence;
 
 class Parser {
 private:
-  Lexer *lexer;
+  TokenSource *lexer;
+  // Used when the parser is not given an interner to share
+  Interner ownSymbols;
+  Interner *symbols;
   Token CurrentToken;
   Token peekToken;
   std::vector<std::string> errors;
-  std::unordered_map<TokenType_t, prefixParseFn> prefixParseFns;
-  std::unordered_map<TokenType_t, infixParseFn> infixParseFns;
-
-  std::unordered_map<std::string, Precedence> precedences;
+  // Source offset of the token each error is about, parallel to errors
+  std::vector<std::uint32_t> errorOffsets;
 
 public:
   Parser() = delete;
-  Parser(Lexer *l);
+  // Parses tokens pulled from a Lexer, a TokenBufferReader or any other
+  // TokenSource. Identifiers are interned into s, or into an interner of the
+  // parser's own if s is null. A Lexer that sets Token::Symbol must have been
+  // given the same interner.
+  Parser(TokenSource *l, Interner *s = nullptr);
 
   void nextToken();
   std::unique_ptr<Program> parseProgram();
+  // parseProgram with every node allocated from a new arena.
+  ParseResult parseProgramInArena();
   std::unique_ptr<Statement> parseStatement();
   std::unique_ptr<LetStatement> parseLetStatement();
   std::unique_ptr<ReturnStatement> parseReturnStatement();
   std::vector<std::string> &getErrors();
+  Interner &getSymbols();
+  // Errors prefixed with "name:line:column: ", e.g. for a script file.
+  std::vector<std::string> formatErrors(std::string_view name,
+                                        LineTable &lines);
+  void addError(std::uint32_t offset, std::string msg);
 
-  void PeekError(std::string_view &t);
-  bool curTokenIs(std::string_view &t);
-  bool peekTokenIs(std::string_view &t);
-  bool expectPeek(std::string_view &t);
+  void PeekError(TokenKind t);
+  bool curTokenIs(TokenKind t);
+  bool peekTokenIs(TokenKind t);
+  bool expectPeek(TokenKind t);
 
-  void registerPrefix(TokenType_t tokenType, prefixParseFn fn);
-  void registerInfix(TokenType_t tokenType, infixParseFn fn);
-  void noPrefixParseFnError(TokenType_t t);
+  void noPrefixParseFnError(TokenKind t);
 
   std::unique_ptr<ExpressionStatement> parseExpressionStatement();
   std::unique_ptr<Expression> parseExpression(Precedence precedence);
   std::unique_ptr<Expression> parseIdentifier();
+  std::unique_ptr<Identifier> makeIdentifier();
   std::unique_ptr<Expression> parseIntegerLiteral();
+  std::unique_ptr<Expression> parseFloatLiteral();
+  std::unique_ptr<Expression> parseStringLiteral();
   std::unique_ptr<Expression> parsePrefixExpression();
   std::unique_ptr<Expression> parseBoolean();
   std::unique_ptr<Expression>
@@ -1,4 +1,5 @@
 #include "../../lexer/lexer.hpp"
+#include "../../lexer/token_buffer.hpp"
 #include "../parser.hpp"
 #include "gtest/gtest.h"
 #include <iostream>
@@ -203,6 +204,104 @@ TEST(Parser, TestIntegerLiteralExpresssion) {
   EXPECT_TRUE(TestIntegerLiteral(stmt->expression.get(), 5));
 }
 
+TEST(Parser, TestIntegerLiteralRange) {
+  std::string input{"9223372036854775807;"};
+
+  Lexer l{input};
+  Parser p{&l};
+  std::unique_ptr<Program> program = p.parseProgram();
+  ASSERT_EQ(p.getErrors().size(), 0) << PrintErrors(p.getErrors());
+  ASSERT_EQ(program->statements.size(), 1);
+
+  auto *stmt =
+      dynamic_cast<ExpressionStatement *>(program->statements[0].get());
+  ASSERT_NE(stmt, nullptr);
+  auto *literal = dynamic_cast<IntegerLiteral *>(stmt->expression.get());
+  ASSERT_NE(literal, nullptr);
+  EXPECT_EQ(literal->value, 9223372036854775807);
+  EXPECT_EQ(program->String(), "9223372036854775807");
+}
+
+TEST(Parser, TestIntegerLiteralOverflowIsAnError) {
+  std::string input{"let x = 1 + 9223372036854775808 * 2;"};
+
+  Lexer l{input};
+  Parser p{&l};
+  std::unique_ptr<Program> program = p.parseProgram();
+
+  ASSERT_EQ(p.getErrors().size(), 1) << PrintErrors(p.getErrors());
+  EXPECT_EQ(p.getErrors()[0],
+            "Integer literal 9223372036854775808 does not fit in 64 bits");
+  LineTable lines{input};
+  EXPECT_EQ(p.formatErrors("x.mk", lines)[0].substr(0, 9), "x.mk:1:13");
+}
+
+TEST(Parser, TestFloatLiteralExpression) {
+  std::string input{"3.5 * 2e3 + -0.25;"};
+
+  Lexer l{input};
+  Parser p{&l};
+  std::unique_ptr<Program> program = p.parseProgram();
+  ASSERT_EQ(p.getErrors().size(), 0) << PrintErrors(p.getErrors());
+  ASSERT_EQ(program->statements.size(), 1);
+  EXPECT_EQ(program->String(), "((3.5 * 2e3) + (-0.25))");
+
+  auto *stmt =
+      dynamic_cast<ExpressionStatement *>(program->statements[0].get());
+  ASSERT_NE(stmt, nullptr);
+  auto *sum = dynamic_cast<InfixExpression *>(stmt->expression.get());
+  ASSERT_NE(sum, nullptr);
+  auto *product = dynamic_cast<InfixExpression *>(sum->left.get());
+  ASSERT_NE(product, nullptr);
+  auto *left = dynamic_cast<FloatLiteral *>(product->left.get());
+  auto *right = dynamic_cast<FloatLiteral *>(product->right.get());
+  ASSERT_NE(left, nullptr);
+  ASSERT_NE(right, nullptr);
+  EXPECT_EQ(left->value, 3.5);
+  EXPECT_EQ(right->value, 2000.0);
+}
+
+TEST(Parser, TestFloatLiteralOverflowIsAnError) {
+  std::string input{"let x = 1e400;"};
+
+  Lexer l{input};
+  Parser p{&l};
+  std::unique_ptr<Program> program = p.parseProgram();
+
+  ASSERT_EQ(p.getErrors().size(), 1) << PrintErrors(p.getErrors());
+  EXPECT_EQ(p.getErrors()[0], "Float literal 1e400 is too large for a double");
+}
+
+TEST(Parser, TestFloatLiteralUnderflowIsZero) {
+  // Out of range without a negative exponent: the leading zeros decide
+  std::string tiny = "0." + std::string(400, '0') + "1";
+  std::vector<std::string> inputs = {tiny, tiny + "e5", "0.001e-400",
+                                     "100e-410"};
+  for (auto &&input : inputs) {
+    Lexer l{input};
+    Parser p{&l};
+    std::unique_ptr<Program> program = p.parseProgram();
+    ASSERT_EQ(p.getErrors().size(), 0) << PrintErrors(p.getErrors());
+    ASSERT_EQ(program->statements.size(), 1);
+
+    auto *stmt =
+        dynamic_cast<ExpressionStatement *>(program->statements[0].get());
+    ASSERT_NE(stmt, nullptr);
+    auto *literal = dynamic_cast<FloatLiteral *>(stmt->expression.get());
+    ASSERT_NE(literal, nullptr) << input;
+    EXPECT_EQ(literal->value, 0.0) << input;
+  }
+
+  // And a long mantissa with a negative exponent can still be too large
+  std::string huge = "1" + std::string(400, '0') + ".5e-10";
+  Lexer l{huge};
+  Parser p{&l};
+  p.parseProgram();
+  ASSERT_EQ(p.getErrors().size(), 1) << PrintErrors(p.getErrors());
+  EXPECT_EQ(p.getErrors()[0],
+            "Float literal " + huge + " is too large for a double");
+}
+
 TEST(Parser, TestParsingPrefixExpressionsint) {
   std::vector<PrefixTests> tests = {
       {"!5;", "!", 5},
@@ -541,6 +640,26 @@ TEST(Parser, TestFunctionParameterParsing) {
   }
 }
 
+TEST(Parser, TestFunctionParametersMustBeIdentifiers) {
+  struct Case {
+    std::string input;
+    std::string error;
+  };
+  // Each would otherwise read Token::Symbol from a token that has none
+  std::vector<Case> cases = {
+      {"fn(1, \"s\") {}", "Expected next token to be: IDENTgot: INT"},
+      {"fn(x, \"s\") {}", "Expected next token to be: IDENTgot: STRING"},
+      {"fn(2.5) {}", "Expected next token to be: IDENTgot: FLOAT"},
+  };
+  for (auto &&c : cases) {
+    Lexer l{c.input};
+    Parser p{&l};
+    p.parseProgram();
+    ASSERT_FALSE(p.getErrors().empty()) << c.input;
+    EXPECT_EQ(p.getErrors()[0], c.error) << c.input;
+  }
+}
+
 TEST(Parser, TestCallExpressionParsing) {
   std::string input{"add(1, 2 * 3, 4 + 5);"};
   Lexer l{input};
@@ -629,13 +748,9 @@ TEST(Parser, TestLetStatements) {
     EXPECT_NE(program, nullptr);
     EXPECT_EQ(program->statements.size(), 1);
 
-    ExpressionStatement *stmt =
-        dynamic_cast<ExpressionStatement *>(program->statements[0].get());
-    EXPECT_NE(stmt, nullptr) << program->statements[0]->TokenLiteral();
-
     LetStatement *letStmt =
-        dynamic_cast<LetStatement *>(stmt->expression.get());
-    EXPECT_NE(letStmt, nullptr);
+        dynamic_cast<LetStatement *>(program->statements[0].get());
+    ASSERT_NE(letStmt, nullptr) << program->statements[0]->TokenLiteral();
     EXPECT_EQ(letStmt->TokenLiteral(), "let");
     EXPECT_EQ(letStmt->name->value, test.expectedIdentifier);
     EXPECT_EQ(letStmt->name->TokenLiteral(), test.expectedIdentifier);
@@ -652,13 +767,9 @@ TEST(Parser, TestLetStatements) {
     EXPECT_NE(program, nullptr);
     EXPECT_EQ(program->statements.size(), 1);
 
-    ExpressionStatement *stmt =
-        dynamic_cast<ExpressionStatement *>(program->statements[0].get());
-    EXPECT_NE(stmt, nullptr);
-
     LetStatement *letStmt =
-        dynamic_cast<LetStatement *>(stmt->expression.get());
-    EXPECT_NE(letStmt, nullptr);
+        dynamic_cast<LetStatement *>(program->statements[0].get());
+    ASSERT_NE(letStmt, nullptr) << program->statements[0]->TokenLiteral();
     EXPECT_EQ(letStmt->TokenLiteral(), "let");
     EXPECT_EQ(letStmt->name->value, test.expectedIdentifier);
     EXPECT_EQ(letStmt->name->TokenLiteral(), test.expectedIdentifier);
@@ -675,13 +786,9 @@ TEST(Parser, TestLetStatements) {
     EXPECT_NE(program, nullptr);
     EXPECT_EQ(program->statements.size(), 1);
 
-    ExpressionStatement *stmt =
-        dynamic_cast<ExpressionStatement *>(program->statements[0].get());
-    EXPECT_NE(stmt, nullptr);
-
     LetStatement *letStmt =
-        dynamic_cast<LetStatement *>(stmt->expression.get());
-    EXPECT_NE(letStmt, nullptr);
+        dynamic_cast<LetStatement *>(program->statements[0].get());
+    ASSERT_NE(letStmt, nullptr) << program->statements[0]->TokenLiteral();
     EXPECT_EQ(letStmt->TokenLiteral(), "let");
     EXPECT_EQ(letStmt->name->value, test.expectedIdentifier);
     EXPECT_EQ(letStmt->name->TokenLiteral(), test.expectedIdentifier);
@@ -690,3 +797,155 @@ TEST(Parser, TestLetStatements) {
     }
   }
 }
+
+TEST(Parser, TestParsingFromTokenBuffer) {
+  std::string input{"let x = 1 + 2 * 3; if (x > y) { return add(x, -y); }"
+                    "!(true == false); fn(a, b) { a / b };"};
+
+  Lexer l{input};
+  Parser lexerParser{&l};
+  std::unique_ptr<Program> expected = lexerParser.parseProgram();
+
+  TokenBuffer tokens = tokenize(input);
+  TokenBufferReader reader{tokens};
+  Parser bufferParser{&reader};
+  std::unique_ptr<Program> program = bufferParser.parseProgram();
+
+  EXPECT_EQ(bufferParser.getErrors().size(), 0)
+      << PrintErrors(bufferParser.getErrors());
+  ASSERT_EQ(program->statements.size(), expected->statements.size());
+  EXPECT_EQ(program->String(), expected->String());
+}
+
+TEST(Parser, TestParseProgramInArena) {
+  std::string input{"let add = fn(x, y) { x + y * 2.5; };\n"
+                    "if (add(1, -2) != 3) { return \"no\"; } else { !true }"};
+
+  Lexer heapLexer{input};
+  Parser heapParser{&heapLexer};
+  std::unique_ptr<Program> expected = heapParser.parseProgram();
+
+  ParseResult result{};
+  {
+    Lexer l{input};
+    Parser p{&l};
+    result = p.parseProgramInArena();
+    ASSERT_EQ(p.getErrors().size(), 0) << PrintErrors(p.getErrors());
+  }
+  // The result owns the nodes, the parser is gone
+  ASSERT_NE(result.arena, nullptr);
+  ASSERT_NE(result.program, nullptr);
+  EXPECT_EQ(result.program->String(), expected->String());
+  EXPECT_GT(result.arena->bytesUsed(), 0u);
+  EXPECT_EQ(result.arena->blockCount(), 1u);
+
+  // Replacing a result frees the old program before its arena
+  Lexer l{input};
+  Parser p{&l};
+  result = p.parseProgramInArena();
+  EXPECT_EQ(result.program->String(), expected->String());
+}
+
+TEST(Parser, TestArenaScopesNest) {
+  Arena outer{};
+  Arena inner{};
+  std::string input{"1 + 2;"};
+  {
+    ArenaScope outerScope{outer};
+    EXPECT_EQ(currentArena(), &outer);
+    {
+      ArenaScope innerScope{inner};
+      EXPECT_EQ(currentArena(), &inner);
+      Lexer l{input};
+      Parser p{&l};
+      p.parseProgram();
+    }
+    EXPECT_EQ(currentArena(), &outer);
+  }
+  EXPECT_EQ(currentArena(), nullptr);
+  EXPECT_GT(inner.bytesUsed(), 0u);
+  EXPECT_EQ(outer.bytesUsed(), 0u);
+
+  // Nodes made outside any scope still come from the heap and can be
+  // deleted one by one
+  Lexer l{input};
+  Parser p{&l};
+  EXPECT_EQ(p.parseProgram()->String(), "(1 + 2)");
+}
+
+TEST(Parser, TestFormatErrors) {
+  std::string input{"let x = 5;\n"
+                    "let = 10;\n"
+                    "  let y 3;"};
+  Lexer l{input};
+  Parser p{&l};
+  p.parseProgram();
+
+  LineTable lines{input};
+  std::vector<std::string> errors = p.formatErrors("script.mk", lines);
+  ASSERT_GE(errors.size(), 2) << PrintErrors(p.getErrors());
+  EXPECT_EQ(errors[0], "script.mk:2:5: " + p.getErrors()[0]);
+  EXPECT_EQ(errors.back(), "script.mk:3:9: " + p.getErrors().back());
+}
+
+TEST(Parser, TestIdentifiersShareSymbols) {
+  std::string input{"let add = fn(x, y) { x + y }; add(y, x);"};
+
+  Interner symbols{};
+  Lexer interning{input, symbols};
+  Parser shared{&interning, &symbols};
+  std::unique_ptr<Program> first = shared.parseProgram();
+
+  Lexer plain{input};
+  Parser own{&plain};
+  std::unique_ptr<Program> second = own.parseProgram();
+
+  for (Parser *p : {&shared, &own}) {
+    ASSERT_EQ(p->getErrors().size(), 0) << PrintErrors(p->getErrors());
+    EXPECT_EQ(p->getSymbols().size(), 3);
+  }
+
+  for (Program *program : {first.get(), second.get()}) {
+    auto *let = dynamic_cast<LetStatement *>(program->statements[0].get());
+    ASSERT_NE(let, nullptr);
+    auto *fn = dynamic_cast<FunctionLiteral *>(let->value.get());
+    ASSERT_NE(fn, nullptr);
+    auto *call = dynamic_cast<ExpressionStatement *>(
+        program->statements[1].get());
+    ASSERT_NE(call, nullptr);
+    auto *callExpr = dynamic_cast<callExpression *>(call->expression.get());
+    ASSERT_NE(callExpr, nullptr);
+    auto *x = dynamic_cast<Identifier *>(callExpr->arguments[1].get());
+    ASSERT_NE(x, nullptr);
+
+    EXPECT_EQ(fn->parameters[0]->symbol, x->symbol);
+    EXPECT_NE(fn->parameters[1]->symbol, x->symbol);
+    EXPECT_EQ(x->value, "x");
+  }
+}
+
+TEST(Parser, TestStringLiteralExpression) {
+  std::string input{R"("hello world"; let s = "say \"hi\"\n";)"};
+
+  Lexer l{input};
+  Parser p{&l};
+  std::unique_ptr<Program> program = p.parseProgram();
+  ASSERT_EQ(p.getErrors().size(), 0) << PrintErrors(p.getErrors());
+  ASSERT_EQ(program->statements.size(), 2);
+
+  auto *stmt =
+      dynamic_cast<ExpressionStatement *>(program->statements[0].get());
+  ASSERT_NE(stmt, nullptr);
+  auto *plain = dynamic_cast<StringLiteral *>(stmt->expression.get());
+  ASSERT_NE(plain, nullptr);
+  EXPECT_EQ(plain->value(), "hello world");
+  // No escapes, so the value is the source text itself
+  EXPECT_EQ(plain->value().data(), input.data() + 1);
+
+  auto *let = dynamic_cast<LetStatement *>(program->statements[1].get());
+  ASSERT_NE(let, nullptr);
+  auto *escaped = dynamic_cast<StringLiteral *>(let->value.get());
+  ASSERT_NE(escaped, nullptr);
+  EXPECT_EQ(escaped->value(), "say \"hi\"\n");
+  EXPECT_EQ(escaped->String(), R"("say \"hi\"\n")");
+}
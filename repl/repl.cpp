@@ -1,13 +1,28 @@
 #include "../lexer/lexer.hpp"
+#include "../lexer/line_table.hpp"
+#include "../lexer/pipelined_lexer.hpp"
+#include "../lexer/token_buffer.hpp"
 #include "../parser/parser.hpp"
+#include "../source/source_file.hpp"
+#include "../source/token_cache.hpp"
 #include "../token/token.hpp"
+#include <cstddef>
 #include <cstdio>
 #include <istream>
+#include <optional>
 #include <ostream>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
 
 const std::string PROMPT = ">> ";
 
+// Scripts at least this big are lexed on a thread of their own while they are
+// parsed, if the machine has a core to spare. Smaller ones are parsed before
+// the thread would have started.
+constexpr std::size_t pipelineThreshold = 256 * 1024;
+
 void Start(std::istream &input, std::ostream &output) {
   std::string line;
   while (true) {
@@ -18,8 +33,8 @@ void Start(std::istream &input, std::ostream &output) {
     // Show the ouptut of the lexer
 
     output << "Lexer Output:\n";
-    Lexer lex{line};
-    for (auto token = lex.nextToken(); token.Type != TokenTypes::EOF_;
+    TerminatedLexer lex{line};
+    for (auto token = lex.nextToken(); token.Type != TokenKind::EOF_;
          token = lex.nextToken()) {
       output << "Type: " << token.Type << "\t" << "Literal: " << token.Literal
              << "\n";
@@ -28,9 +43,7 @@ void Start(std::istream &input, std::ostream &output) {
     output << "\n";
 
     output << "Parser Output:\n";
-    class Lexer l {
-      line
-    };
+    TerminatedLexer l{line};
     Parser p{&l};
     auto program = p.parseProgram();
     // Print the parsed program
@@ -44,3 +57,43 @@ void Start(std::istream &input, std::ostream &output) {
     }
   }
 }
+
+int RunFile(const std::string &path, std::ostream &output,
+            bool useTokenCache) {
+  try {
+    SourceFile file{path};
+    Lexer l{file.view()};
+    TokenBuffer tokens{};
+    TokenBufferReader reader{tokens};
+    std::optional<PipelinedLexer> pipelined{};
+    TokenSource *source = &l;
+    if (useTokenCache) {
+      tokens = tokenizeCached(file.view(), tokenCachePath(path));
+      source = &reader;
+    } else if (file.view().size() >= pipelineThreshold &&
+               std::thread::hardware_concurrency() > 1) {
+      pipelined.emplace(file.view());
+      source = &*pipelined;
+    }
+    Parser p{source};
+    // The whole AST is dropped at once when the script is done
+    ParseResult result = p.parseProgramInArena();
+
+    if (p.getErrors().size() != 0) {
+      LineTable lines{file.view()};
+      for (auto &&error : p.formatErrors(path, lines)) {
+        output << error << "\n";
+      }
+      return 1;
+    }
+    output << result.program->String() << "\n";
+    return 0;
+  } catch (const std::system_error &error) {
+    output << error.what() << "\n";
+    return 1;
+  } catch (const std::length_error &error) {
+    // Token offsets are 32 bits, so neither lexing path takes 4 GiB or more
+    output << path << ": " << error.what() << "\n";
+    return 1;
+  }
+}
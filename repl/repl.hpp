@@ -1,3 +1,10 @@
 #include <istream>
 #include <ostream>
+#include <string>
 void Start(std::istream &input, std::ostream &output);
+
+// Maps the script at path, parses it and prints the program or the parser
+// errors. Returns the process exit code. With useTokenCache the tokens are
+// loaded from (or saved to) the token cache next to the script.
+int RunFile(const std::string &path, std::ostream &output,
+            bool useTokenCache = false);
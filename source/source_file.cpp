@@ -0,0 +1,76 @@
+#include "source_file.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void throwErrno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+SourceFile::SourceFile(const std::string &p)
+    : path{p}, data{nullptr}, size{} {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throwErrno("cannot open " + path);
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    throwErrno("cannot stat " + path);
+  }
+
+  // mmap rejects empty mappings, an empty file is just an empty view
+  size = static_cast<std::size_t>(info.st_size);
+  if (size != 0) {
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      throwErrno("cannot map " + path);
+    }
+    // The lexer reads front to back, let the kernel read ahead
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(mapping);
+  }
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+}
+
+SourceFile::~SourceFile() {
+  if (data != nullptr) {
+    munmap(const_cast<char *>(data), size);
+  }
+}
+
+SourceFile::SourceFile(SourceFile &&other) noexcept
+    : path{std::move(other.path)}, data{other.data}, size{other.size} {
+  other.data = nullptr;
+  other.size = 0;
+}
+
+SourceFile &SourceFile::operator=(SourceFile &&other) noexcept {
+  if (this != &other) {
+    if (data != nullptr) {
+      munmap(const_cast<char *>(data), size);
+    }
+    path = std::move(other.path);
+    data = std::exchange(other.data, nullptr);
+    size = std::exchange(other.size, 0);
+  }
+  return *this;
+}
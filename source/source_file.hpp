@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A script file mapped read-only into memory. The Lexer and Parser work
+// directly on view(), so loading a file costs page faults instead of a read
+// and a copy. The mapping lives as long as the SourceFile, which therefore
+// has to outlive every token and AST node built from it.
+class SourceFile {
+private:
+  std::string path;
+  const char *data;
+  std::size_t size;
+
+public:
+  // Maps the file at path. Throws std::system_error if it cannot be opened
+  // or mapped.
+  explicit SourceFile(const std::string &p);
+  ~SourceFile();
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+  SourceFile(SourceFile &&other) noexcept;
+  SourceFile &operator=(SourceFile &&other) noexcept;
+
+  std::string_view view() const { return std::string_view(data, size); }
+  const std::string &getPath() const { return path; }
+};
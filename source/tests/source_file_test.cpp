@@ -0,0 +1,79 @@
+#include "../../lexer/lexer.hpp"
+#include "../../parser/parser.hpp"
+#include "../source_file.hpp"
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// Writes contents to a fresh file in the temp directory and returns its path.
+std::string writeTempFile(const std::string &name,
+                          const std::string &contents) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+  std::ofstream out{path, std::ios::binary};
+  out << contents;
+  return path.string();
+}
+
+TEST(SourceFile, MapsFileContents) {
+  std::string contents{"let x = 5;\nlet y = fn(a) { a + x };\n"};
+  std::string path = writeTempFile("monkey_source_map.mk", contents);
+
+  SourceFile file{path};
+  EXPECT_EQ(file.view(), contents);
+  EXPECT_EQ(file.getPath(), path);
+  std::filesystem::remove(path);
+}
+
+TEST(SourceFile, LexesAndParsesInPlace) {
+  std::string path = writeTempFile("monkey_source_parse.mk",
+                                   "let add = fn(a, b) { a + b };\n"
+                                   "add(1, 2 * 3);\n");
+  SourceFile file{path};
+  std::string_view source = file.view();
+
+  Lexer l{source};
+  for (Token token = l.nextToken(); token.Type != TokenKind::EOF_;
+       token = l.nextToken()) {
+    EXPECT_GE(token.Literal.data(), source.data());
+    EXPECT_LE(token.Literal.data() + token.Literal.size(),
+              source.data() + source.size());
+  }
+
+  Lexer parserLexer{source};
+  Parser p{&parserLexer};
+  std::unique_ptr<Program> program = p.parseProgram();
+  EXPECT_EQ(p.getErrors().size(), 0);
+  ASSERT_EQ(program->statements.size(), 2);
+  EXPECT_EQ(program->statements[1]->String(), "add(1, (2 * 3))");
+  std::filesystem::remove(path);
+}
+
+TEST(SourceFile, EmptyFile) {
+  std::string path = writeTempFile("monkey_source_empty.mk", "");
+  SourceFile file{path};
+  EXPECT_TRUE(file.view().empty());
+
+  Lexer l{file.view()};
+  EXPECT_EQ(l.nextToken().Type, TokenKind::EOF_);
+  std::filesystem::remove(path);
+}
+
+TEST(SourceFile, MissingFileThrows) {
+  EXPECT_THROW(SourceFile{"/nonexistent/monkey/script.mk"}, std::system_error);
+}
+
+TEST(SourceFile, MoveKeepsMapping) {
+  std::string path = writeTempFile("monkey_source_move.mk", "return 10;");
+  SourceFile first{path};
+  const char *data = first.view().data();
+
+  SourceFile second{std::move(first)};
+  EXPECT_EQ(second.view().data(), data);
+  EXPECT_EQ(second.view(), "return 10;");
+  EXPECT_TRUE(first.view().empty());
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,149 @@
+#include "../../lexer/token_buffer.hpp"
+#include "../token_cache.hpp"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void expectSameTokens(const TokenBuffer &actual, const TokenBuffer &expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(actual.kind(i), expected.kind(i)) << "token " << i;
+    ASSERT_EQ(actual.start(i), expected.start(i)) << "token " << i;
+    ASSERT_EQ(actual.length(i), expected.length(i)) << "token " << i;
+    ASSERT_EQ(actual.match(i), expected.match(i)) << "token " << i;
+  }
+}
+
+std::string programSource() {
+  std::string source{};
+  for (int i = 0; i < 500; ++i) {
+    source += "let add = fn(x, y) { x + y }; // adds\n"
+              "if (add(1, 22) != 333) { return \"big\"; } /* else */\n";
+  }
+  return source;
+}
+
+} // namespace
+
+TEST(TokenCache, RoundTrips) {
+  std::string source = programSource();
+  TokenBuffer tokens = tokenize(source);
+
+  std::string encoded = encodeTokenCache(tokens);
+  EXPECT_LT(encoded.size(), tokens.size() * 4);
+
+  std::optional<TokenBuffer> decoded = decodeTokenCache(encoded, source);
+  ASSERT_TRUE(decoded.has_value());
+  EXPECT_EQ(decoded->source.data(), source.data());
+  expectSameTokens(*decoded, tokens);
+}
+
+TEST(TokenCache, RejectsStaleOrDamagedData) {
+  std::string source = programSource();
+  std::string encoded = encodeTokenCache(tokenize(source));
+
+  // Same size, one byte changed
+  std::string edited = source;
+  edited[source.size() / 2] = 'z';
+  EXPECT_FALSE(decodeTokenCache(encoded, edited).has_value());
+  EXPECT_FALSE(decodeTokenCache(encoded, source + " ").has_value());
+
+  EXPECT_FALSE(decodeTokenCache(encoded.substr(0, encoded.size() - 1), source)
+                   .has_value());
+  EXPECT_FALSE(decodeTokenCache(encoded + "x", source).has_value());
+  EXPECT_FALSE(decodeTokenCache("", source).has_value());
+
+  std::string otherVersion = encoded;
+  otherVersion[4] = static_cast<char>(otherVersion[4] + 1);
+  EXPECT_FALSE(decodeTokenCache(otherVersion, source).has_value());
+}
+
+TEST(TokenCache, TokenizeCachedSkipsLexingOnHit) {
+  std::string source = programSource();
+  std::string cachePath =
+      (std::filesystem::temp_directory_path() / "monkey_cache_test.tokens")
+          .string();
+  std::filesystem::remove(cachePath);
+
+  // A miss lexes and writes the cache
+  expectSameTokens(tokenizeCached(source, cachePath), tokenize(source));
+  ASSERT_TRUE(std::filesystem::exists(cachePath));
+
+  // Plant a cache for the same contents whose tokens differ from what the
+  // lexer would give; getting them back shows the lexer did not run.
+  TokenBuffer lexed = tokenize(source);
+  TokenBuffer planted{};
+  planted.source = source;
+  for (std::size_t i = 0; i < lexed.size(); ++i) {
+    planted.push(i == 0 ? TokenKind::ILLEGAL : lexed.kind(i), lexed.start(i),
+                 lexed.length(i));
+  }
+  planted.computeMatches();
+  {
+    std::string encoded = encodeTokenCache(planted);
+    std::ofstream out{cachePath, std::ios::binary | std::ios::trunc};
+    out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+  }
+  expectSameTokens(tokenizeCached(source, cachePath), planted);
+
+  // Changing the source invalidates it
+  std::string edited = source + "let more = 1;";
+  expectSameTokens(tokenizeCached(edited, cachePath), tokenize(edited));
+  std::ifstream in{cachePath, std::ios::binary};
+  std::string stored{std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>()};
+  ASSERT_TRUE(decodeTokenCache(stored, edited).has_value());
+
+  std::filesystem::remove(cachePath);
+}
+
+TEST(TokenCache, ConcurrentWritersPublishWholeCaches) {
+  std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "monkey_cache_race_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  std::string cachePath = (directory / "script.mk.tokens").string();
+
+  // Writers with different sources race to replace the same cache
+  std::vector<std::string> sources{};
+  for (int i = 0; i < 4; ++i) {
+    sources.push_back(programSource() + "let writer = " + std::to_string(i) +
+                      ";");
+  }
+  std::vector<std::thread> writers{};
+  for (auto &&source : sources) {
+    writers.emplace_back([&] {
+      for (int round = 0; round < 20; ++round) {
+        tokenizeCached(source, cachePath);
+      }
+    });
+  }
+  for (auto &&writer : writers) {
+    writer.join();
+  }
+
+  // Whoever renamed last, the cache is one writer's complete file and no
+  // temporary file is left behind
+  std::ifstream in{cachePath, std::ios::binary};
+  std::string stored{std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>()};
+  bool valid = false;
+  for (auto &&source : sources) {
+    valid = valid || decodeTokenCache(stored, source).has_value();
+  }
+  EXPECT_TRUE(valid);
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator{directory},
+                          std::filesystem::directory_iterator{}),
+            1);
+
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,235 @@
+#include "token_cache.hpp"
+#include "../lexer/token_buffer.hpp"
+#include "../token/token.hpp"
+#include "source_file.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char magic[4] = {'M', 'K', 'T', 'C'};
+constexpr std::size_t headerSize = sizeof(magic) + 4 + 8 + 8 + 8;
+
+// Writes all of data to fd, retrying short and interrupted writes.
+bool writeAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(static_cast<std::size_t>(written));
+  }
+  return true;
+}
+
+std::uint64_t read64(const char *p) {
+  std::uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// Multiplies to 128 bits and folds the halves together
+std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<std::uint64_t>(product) ^
+         static_cast<std::uint64_t>(product >> 64);
+#else
+  std::uint64_t product = a * b;
+  return product ^ (product >> 29);
+#endif
+}
+
+void putInteger(std::string &out, std::uint64_t value, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+std::uint64_t getInteger(const char *p, std::size_t bytes) {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    value |= std::uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+  }
+  return value;
+}
+
+void putVarint(std::string &out, std::uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Reads a varint at pos and moves pos past it; false if data ends first or
+// the value does not fit in 32 bits.
+bool getVarint(std::string_view data, std::size_t &pos, std::uint32_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 35; shift += 7) {
+    if (pos >= data.size()) {
+      return false;
+    }
+    unsigned char byte = static_cast<unsigned char>(data[pos++]);
+    value |= std::uint32_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return shift < 28 || byte < 0x10;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+std::uint64_t contentHash(std::string_view source) {
+  constexpr std::uint64_t secret[] = {
+      0xa0761d6478bd642full,
+      0xe7037ed1a0b428dbull,
+      0x8ebc6af09c88c6e3ull,
+      0x589965cc75374cc3ull,
+  };
+  const char *p = source.data();
+  std::size_t left = source.size();
+  std::uint64_t seed = secret[0] ^ source.size();
+  for (; left >= 16; p += 16, left -= 16) {
+    seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+  }
+  char tail[16] = {};
+  std::memcpy(tail, p, left);
+  seed = mix(read64(tail) ^ secret[2], read64(tail + 8) ^ seed);
+  return mix(seed ^ secret[3], source.size() ^ secret[1]);
+}
+
+std::string encodeTokenCache(const TokenBuffer &tokens) {
+  std::string out{};
+  out.reserve(headerSize + tokens.size() * 3);
+  out.append(magic, sizeof(magic));
+  putInteger(out, tokenCacheVersion, 4);
+  putInteger(out, contentHash(tokens.source), 8);
+  putInteger(out, tokens.source.size(), 8);
+  putInteger(out, tokens.size(), 8);
+
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    out.push_back(static_cast<char>(tokens.kind(i)));
+  }
+  std::uint32_t previousEnd = 0;
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    putVarint(out, tokens.start(i) - previousEnd);
+    putVarint(out, tokens.length(i));
+    previousEnd = tokens.end(i);
+  }
+  return out;
+}
+
+std::optional<TokenBuffer> decodeTokenCache(std::string_view data,
+                                            std::string_view source) {
+  if (data.size() < headerSize ||
+      std::memcmp(data.data(), magic, sizeof(magic)) != 0) {
+    return std::nullopt;
+  }
+  const char *header = data.data() + sizeof(magic);
+  std::uint64_t count = getInteger(header + 20, 8);
+  // Check the size first, it is much cheaper than the hash
+  if (getInteger(header, 4) != tokenCacheVersion ||
+      getInteger(header + 12, 8) != source.size() ||
+      count > data.size() - headerSize ||
+      getInteger(header + 4, 8) != contentHash(source)) {
+    return std::nullopt;
+  }
+
+  std::string_view kinds = data.substr(headerSize, count);
+  for (char kind : kinds) {
+    if (static_cast<unsigned char>(kind) >= tokenKindCount) {
+      return std::nullopt;
+    }
+  }
+  if (count == 0 || static_cast<TokenKind>(kinds.back()) != TokenKind::EOF_) {
+    return std::nullopt;
+  }
+
+  TokenBuffer tokens{};
+  tokens.source = source;
+  tokens.reserve(count);
+  std::size_t pos = headerSize + count;
+  std::uint64_t previousEnd = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint32_t gap;
+    std::uint32_t length;
+    if (!getVarint(data, pos, gap) || !getVarint(data, pos, length)) {
+      return std::nullopt;
+    }
+    std::uint64_t start = previousEnd + gap;
+    if (start + length > source.size()) {
+      return std::nullopt;
+    }
+    tokens.push(static_cast<TokenKind>(kinds[i]),
+                static_cast<std::uint32_t>(start), length);
+    previousEnd = start + length;
+  }
+  if (pos != data.size()) {
+    return std::nullopt;
+  }
+  // Matches follow from the kinds alone, so they are not stored
+  tokens.computeMatches();
+  return tokens;
+}
+
+std::string tokenCachePath(const std::string &sourcePath) {
+  return sourcePath + ".tokens";
+}
+
+TokenBuffer tokenizeCached(std::string_view source,
+                           const std::string &cachePath) {
+  try {
+    SourceFile cache{cachePath};
+    std::optional<TokenBuffer> cached = decodeTokenCache(cache.view(), source);
+    if (cached) {
+      return std::move(*cached);
+    }
+  } catch (const std::system_error &) {
+    // No cache yet
+  }
+
+  TokenBuffer tokens = tokenize(source);
+
+  // Write to a temporary file of our own and rename it over the cache, so a
+  // process reading the cache never sees half of it. Each writer gets a
+  // unique file from mkstemp, so processes writing the same cache at once
+  // never write into the same file; the last rename wins, and every version
+  // is complete.
+  std::string encoded = encodeTokenCache(tokens);
+  std::string temporary = cachePath + ".XXXXXX";
+  int fd = mkstemp(temporary.data());
+  if (fd < 0) {
+    return tokens;
+  }
+  // mkstemp makes the file private to its owner; a cache is as readable as
+  // the scripts it is made from
+  fchmod(fd, 0644);
+  bool written = writeAll(fd, encoded);
+  written = close(fd) == 0 && written;
+
+  std::error_code error{};
+  if (written) {
+    std::filesystem::rename(temporary, cachePath, error);
+  }
+  if (!written || error) {
+    std::filesystem::remove(temporary, error);
+  }
+  return tokens;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../lexer/token_buffer.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// A pre-lexed token stream stored next to a script, so a script loaded again
+// and again is only lexed the first time. The cache is keyed by a hash of the
+// source contents (and of its size), so any edit to the script invalidates it
+// without timestamps being involved.
+//
+// Layout, integers little endian:
+//   "MKTC", u32 version, u64 content hash, u64 source size, u64 token count,
+//   one byte per token kind, then per token two LEB128 varints: the gap from
+//   the end of the previous token to its start, and its length.
+// Gaps and lengths are almost always below 128, so a token takes about three
+// bytes instead of the 13 of a TokenBuffer.
+
+// Bump whenever the lexer could split the same source into different tokens,
+// so caches written by an older lexer are ignored.
+constexpr std::uint32_t tokenCacheVersion = 3;
+
+// Fast 64-bit hash of source in the style of wyhash. Not for cryptographic
+// use.
+std::uint64_t contentHash(std::string_view source);
+
+// Serialises tokens, a tokenize() of tokens.source.
+std::string encodeTokenCache(const TokenBuffer &tokens);
+
+// Rebuilds the TokenBuffer of source from data, or returns nothing if data was
+// written for different contents, by another cache version or is damaged.
+std::optional<TokenBuffer> decodeTokenCache(std::string_view data,
+                                            std::string_view source);
+
+// Where the cache of the script at sourcePath is kept.
+std::string tokenCachePath(const std::string &sourcePath);
+
+// tokenize(source), going through the cache file at cachePath: a valid cache
+// is loaded without lexing, otherwise the source is lexed and the cache is
+// (re)written. Failing to write the cache is not an error.
+TokenBuffer tokenizeCached(std::string_view source,
+                           const std::string &cachePath);
@@ -0,0 +1,61 @@
+#include "interner.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+
+namespace {
+constexpr std::size_t blockSize = 16 * 1024;
+}
+
+Interner::Interner()
+    : mutex{}, ids{}, names{}, blocks{}, blockEnd{nullptr}, blockLeft{0} {}
+
+std::string_view Interner::store(std::string_view text) {
+  if (text.size() > blockLeft) {
+    std::size_t size = std::max(blockSize, text.size());
+    blocks.push_back(std::make_unique<char[]>(size));
+    blockEnd = blocks.back().get();
+    blockLeft = size;
+  }
+  std::memcpy(blockEnd, text.data(), text.size());
+  std::string_view stored{blockEnd, text.size()};
+  blockEnd += text.size();
+  blockLeft -= text.size();
+  return stored;
+}
+
+SymbolId Interner::intern(std::string_view text) {
+  {
+    std::shared_lock lock{mutex};
+    auto found = ids.find(text);
+    if (found != ids.end()) {
+      return found->second;
+    }
+  }
+
+  std::unique_lock lock{mutex};
+  // Another thread may have added it between the two locks
+  auto found = ids.find(text);
+  if (found != ids.end()) {
+    return found->second;
+  }
+  SymbolId id = static_cast<SymbolId>(names.size());
+  std::string_view stored = store(text);
+  ids.emplace(stored, id);
+  names.push_back(stored);
+  return id;
+}
+
+std::string_view Interner::name(SymbolId id) const {
+  std::shared_lock lock{mutex};
+  return names[id];
+}
+
+std::size_t Interner::size() const {
+  std::shared_lock lock{mutex};
+  return names.size();
+}
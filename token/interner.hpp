@@ -0,0 +1,43 @@
+#pragma once
+#include "token.hpp"
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Maps every distinct identifier to a dense SymbolId (0, 1, 2, ... in order of
+// first appearance), so names can be stored and compared as integers. Each
+// distinct name is copied once into a block the interner owns; name() views
+// into those blocks stay valid for the interner's lifetime.
+//
+// An interner can be shared by several lexers and parsers on different
+// threads. Lookups of names already interned only take a shared lock.
+class Interner {
+private:
+  mutable std::shared_mutex mutex;
+  std::unordered_map<std::string_view, SymbolId> ids;
+  std::vector<std::string_view> names;
+
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char *blockEnd;
+  std::size_t blockLeft;
+
+  // Copies text into the current block, starting a new one if it is full.
+  std::string_view store(std::string_view text);
+
+public:
+  Interner();
+  Interner(const Interner &) = delete;
+  Interner &operator=(const Interner &) = delete;
+
+  // Returns the id of text, adding it if it has not been seen before.
+  SymbolId intern(std::string_view text);
+
+  // Text of an id returned by intern().
+  std::string_view name(SymbolId id) const;
+
+  // Number of distinct names interned so far.
+  std::size_t size() const;
+};
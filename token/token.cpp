@@ -1,63 +1,117 @@
 #include "token.hpp"
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
-
-std::string_view TokenTypes::ILLEGAL{"ILLEGAL"};
-std::string_view TokenTypes::EOF_{"EOF"};
-
-// Identifiers and Literals
-std::string_view TokenTypes::IDENT{"IDENT"};
-std::string_view TokenTypes::INT{"INT"};
-
-// Operators
-std::string_view TokenTypes::ASSIGN{"="};
-std::string_view TokenTypes::PLUS{"+"};
-std::string_view TokenTypes::MINUS{"-"};
-std::string_view TokenTypes::BANG{"!"};
-std::string_view TokenTypes::ASTERISK{"*"};
-std::string_view TokenTypes::SLASH{"/"};
-
-std::string_view TokenTypes::LT{"<"};
-std::string_view TokenTypes::GT{">"};
-std::string_view TokenTypes::EQ{"=="};
-std::string_view TokenTypes::NOT_EQ{"!="};
-
-// Delimiters
-std::string_view TokenTypes::COMMA{","};
-std::string_view TokenTypes::SEMICOLON{";"};
-
-std::string_view TokenTypes::LPAREN{"("};
-std::string_view TokenTypes::RPAREN{")"};
-std::string_view TokenTypes::LBRACE{"{"};
-std::string_view TokenTypes::RBRACE{"}"};
-
-// Keywords
-std::string_view TokenTypes::FUNCTION{"FUNCTION"};
-std::string_view TokenTypes::LET{"LET"};
-std::string_view TokenTypes::TRUE{"TRUE"};
-std::string_view TokenTypes::FALSE{"FALSE"};
-std::string_view TokenTypes::IF{"IF"};
-std::string_view TokenTypes::ELSE{"ELSE"};
-std::string_view TokenTypes::RETURN{"RETURN"};
-
-std::unordered_map<std::string, TokenType_t> Token::keywords{
-    {"fn", std::string(TokenTypes::FUNCTION)},
-    {"let", std::string(TokenTypes::LET)},
-    {"fn", std::string(TokenTypes::FUNCTION)},
-    {"let", std::string(TokenTypes::LET)},
-    {"true", std::string(TokenTypes::TRUE)},
-    {"false", std::string(TokenTypes::FALSE)},
-    {"if", std::string(TokenTypes::IF)},
-    {"else", std::string(TokenTypes::ELSE)},
-    {"return", std::string(TokenTypes::RETURN)},
-
-};
-
-void Token::setIdentifier(std::string ident) {
-  if (auto search = keywords.find(ident); search != keywords.end()) {
-    Type = search->second;
-  } else {
-    Type = TokenTypes::IDENT;
+
+std::ostream &operator<<(std::ostream &os, TokenKind kind) {
+  return os << tokenKindName(kind);
+}
+
+std::int64_t integerLiteralValue(std::string_view digits) {
+  // Up to 18 digits cannot overflow, and nearly every literal is that short.
+  if (digits.size() <= 18) {
+    std::int64_t value = 0;
+    for (char digit : digits) {
+      value = value * 10 + (digit - '0');
+    }
+    return value;
+  }
+  std::int64_t value = 0;
+  auto [end, error] =
+      std::from_chars(digits.data(), digits.data() + digits.size(), value);
+  if (error != std::errc{} || end != digits.data() + digits.size()) {
+    return integerOverflow;
+  }
+  return value;
+}
+
+namespace {
+
+// Decimal exponent of the leading digit of a literal that from_chars found
+// out of range: "123.4e5" gives 7, "0.001" gives -3. Only its sign matters,
+// so an absurdly long exponent saturates instead of overflowing.
+long long literalMagnitude(std::string_view literal) {
+  std::size_t exponentAt = literal.find_first_of("eE");
+  std::string_view mantissa = literal.substr(0, exponentAt);
+  std::size_t point = mantissa.find('.');
+  if (point == std::string_view::npos) {
+    point = mantissa.size();
+  }
+  std::size_t first = mantissa.find_first_of("123456789");
+  long long magnitude =
+      first < point ? static_cast<long long>(point - first - 1)
+                    : -static_cast<long long>(first - point);
+
+  constexpr long long saturated = 1'000'000'000;
+  long long exponent = 0;
+  bool negative = false;
+  if (exponentAt != std::string_view::npos) {
+    for (char ch : literal.substr(exponentAt + 1)) {
+      if (ch == '-') {
+        negative = true;
+      } else if (ch != '+' && exponent < saturated) {
+        exponent = exponent * 10 + (ch - '0');
+      }
+    }
+  }
+  return magnitude + (negative ? -exponent : exponent);
+}
+
+} // namespace
+
+double floatLiteralValue(std::string_view literal) {
+  // from_chars rounds correctly and, unlike strtod, needs neither a NUL
+  // terminator nor the C locale.
+  double value = 0;
+  auto [end, error] =
+      std::from_chars(literal.data(), literal.data() + literal.size(), value);
+  if (error == std::errc::result_out_of_range) {
+    // The value is left alone then; the literal's magnitude says which way
+    // it went out of range, whether or not it has an exponent.
+    return literalMagnitude(literal) < 0
+               ? 0.0
+               : std::numeric_limits<double>::infinity();
+  }
+  return value;
+}
+
+std::string decodeEscapes(std::string_view body) {
+  std::string decoded{};
+  decoded.reserve(body.size());
+  for (std::size_t i = 0; i < body.size(); ++i) {
+    char ch = body[i];
+    if (ch == '\\' && i + 1 < body.size()) {
+      ch = body[++i];
+      switch (ch) {
+      case 'n':
+        ch = '\n';
+        break;
+      case 't':
+        ch = '\t';
+        break;
+      case 'r':
+        ch = '\r';
+        break;
+      default:
+        break;
+      }
+    }
+    decoded.push_back(ch);
+  }
+  return decoded;
+}
+
+// Catch a TokenKind added to the enum without a matching printable name.
+constexpr bool allTokenKindsNamed() {
+  for (auto name : tokenKindNames) {
+    if (name.empty()) {
+      return false;
+    }
   }
+  return true;
 }
+static_assert(allTokenKindsNamed(), "tokenKindNames is missing a TokenKind");
@@ -1,64 +1,213 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 
-using TokenType_t = std::string;
-
-struct TokenTypes {
-  static std::string_view ILLEGAL;
-  static std::string_view EOF_;
+// Every kind of token the lexer can produce. The enum is a single byte so a
+// Token's type is copied and compared as an integer instead of a string.
+enum class TokenKind : std::uint8_t {
+  ILLEGAL,
+  EOF_,
 
   // Identifiers and Literals
-  static std::string_view IDENT;
-  static std::string_view INT;
+  IDENT,
+  INT,
+  FLOAT,
+  STRING,
 
   // Operators
-  static std::string_view ASSIGN;
-  static std::string_view PLUS;
-  static std::string_view MINUS;
-  static std::string_view BANG;
-  static std::string_view ASTERISK;
-  static std::string_view SLASH;
+  ASSIGN,
+  PLUS,
+  MINUS,
+  BANG,
+  ASTERISK,
+  SLASH,
 
-  static std::string_view LT;
-  static std::string_view GT;
+  LT,
+  GT,
 
-  static std::string_view EQ;
-  static std::string_view NOT_EQ;
+  EQ,
+  NOT_EQ,
 
   // Delimiters
-  static std::string_view COMMA;
-  static std::string_view SEMICOLON;
+  COMMA,
+  SEMICOLON,
 
-  static std::string_view LPAREN;
-  static std::string_view RPAREN;
-  static std::string_view LBRACE;
-  static std::string_view RBRACE;
+  LPAREN,
+  RPAREN,
+  LBRACE,
+  RBRACE,
 
   // Keywords
-  static std::string_view FUNCTION;
-  static std::string_view LET;
-  static std::string_view TRUE;
-  static std::string_view FALSE;
-  static std::string_view IF;
-  static std::string_view ELSE;
-  static std::string_view RETURN;
+  FUNCTION,
+  LET,
+  TRUE,
+  FALSE,
+  IF,
+  ELSE,
+  RETURN,
+
+  // Number of token kinds, not a real token
+  COUNT,
 };
 
-struct Token {
-  TokenType_t Type;
-  std::string Literal;
+constexpr std::size_t tokenKindCount =
+    static_cast<std::size_t>(TokenKind::COUNT);
+
+// Printable name of every TokenKind, in the same order as the enum.
+constexpr std::array<std::string_view, tokenKindCount> tokenKindNames{
+    "ILLEGAL", "EOF",   "IDENT", "INT",   "FLOAT",    "STRING", "=",
+    "+",       "-",     "!",     "*",     "/",        "<",      ">",
+    "==",      "!=",    ",",     ";",     "(",        ")",      "{",
+    "}",       "FUNCTION", "LET", "TRUE", "FALSE",    "IF",     "ELSE",
+    "RETURN",
+};
+
+constexpr std::string_view tokenKindName(TokenKind kind) {
+  return tokenKindNames[static_cast<std::size_t>(kind)];
+}
+
+std::ostream &operator<<(std::ostream &os, TokenKind kind);
+
+struct Keyword {
+  std::string_view text;
+  TokenKind kind;
+};
+
+// Keywords i.e. builtin identifiers. This is the only list of keywords; the
+// lookup table below is generated from it at compile time.
+constexpr std::array<Keyword, 7> keywords{{
+    {"fn", TokenKind::FUNCTION},
+    {"let", TokenKind::LET},
+    {"true", TokenKind::TRUE},
+    {"false", TokenKind::FALSE},
+    {"if", TokenKind::IF},
+    {"else", TokenKind::ELSE},
+    {"return", TokenKind::RETURN},
+}};
+
+constexpr std::size_t keywordTableSize = 8;
+
+// Perfect hash over the keyword table: length, first and last charachter are
+// enough to give every keyword its own slot. It is only called with a
+// non-empty identifier.
+constexpr std::size_t keywordHash(std::string_view ident) {
+  return (ident.size() + 2 * static_cast<unsigned char>(ident.front()) +
+          static_cast<unsigned char>(ident.back())) %
+         keywordTableSize;
+}
+
+// Maps each hash slot to 1 + the index of its keyword, 0 for an empty slot.
+constexpr std::array<std::uint8_t, keywordTableSize> buildKeywordSlots() {
+  std::array<std::uint8_t, keywordTableSize> slots{};
+  for (std::size_t i = 0; i < keywords.size(); ++i) {
+    slots[keywordHash(keywords[i].text)] = static_cast<std::uint8_t>(i + 1);
+  }
+  return slots;
+}
+
+constexpr std::array<std::uint8_t, keywordTableSize> keywordSlots =
+    buildKeywordSlots();
 
-  // Map that stores keywords i.e. builtin identifiers.
-  static std::unordered_map<std::string, TokenType_t> keywords;
+constexpr bool keywordHashIsPerfect() {
+  for (std::size_t i = 0; i < keywords.size(); ++i) {
+    if (keywordSlots[keywordHash(keywords[i].text)] != i + 1) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(keywordHashIsPerfect(),
+              "keywordHash collides, change its constants or table size");
+
+constexpr std::size_t longestKeyword() {
+  std::size_t longest = 0;
+  for (const Keyword &keyword : keywords) {
+    if (keyword.text.size() > longest) {
+      longest = keyword.text.size();
+    }
+  }
+  return longest;
+}
+
+// Identifiers longer than this skip the hash entirely.
+constexpr std::size_t maxKeywordLength = longestKeyword();
+
+// Returns the keyword kind of ident, or IDENT if it is not a keyword. Costs
+// one hash of two charachters and at most one short compare.
+constexpr TokenKind lookupIdent(std::string_view ident) {
+  if (ident.empty() || ident.size() > maxKeywordLength) {
+    return TokenKind::IDENT;
+  }
+  std::uint8_t slot = keywordSlots[keywordHash(ident)];
+  if (slot != 0 && keywords[slot - 1].text == ident) {
+    return keywords[slot - 1].kind;
+  }
+  return TokenKind::IDENT;
+}
+
+// Dense id of an identifier interned by an Interner.
+using SymbolId = std::uint32_t;
+
+// Symbol of every token that is not an interned identifier.
+constexpr SymbolId noSymbol = ~SymbolId{0};
+
+// Value of an INT token whose digits do not fit in an int64_t. Literals have
+// no sign (a leading minus is a prefix operator), so no real value is negative.
+constexpr std::int64_t integerOverflow = -1;
+
+// Value of a run of decimal digits, or integerOverflow.
+std::int64_t integerLiteralValue(std::string_view digits);
+
+// Value of a FLOAT token's literal: digits with a fraction, an exponent or
+// both ("3.14", "1e9", "2.5E-3"). Rounded to the nearest double; a literal
+// too large for a double gives infinity, one too small gives 0.
+double floatLiteralValue(std::string_view literal);
+
+// The text between the quotes of a STRING token's Literal, escapes undecoded.
+constexpr std::string_view stringLiteralBody(std::string_view literal) {
+  return literal.substr(1, literal.size() - 2);
+}
+
+// Decodes the escapes in a string body: \n, \t, \r, \\ and \". A backslash
+// before any other charachter stands for that charachter.
+std::string decodeEscapes(std::string_view body);
+
+// Token::Offset of a token starting 4 GiB - 1 or more into its input. Only a
+// StreamLexer gets that far; it also keeps the full 64 bit offset.
+constexpr std::uint32_t offsetOverflow = ~std::uint32_t{0};
+
+// A token does not own its text: Literal is a view into the source buffer the
+// Lexer was given, so that buffer has to outlive every token (and AST node)
+// built from it. Offset is the byte offset of the token in that buffer; line
+// and column are only worked out from it when a diagnostic is printed.
+struct Token {
+  TokenKind Type;
+  std::uint32_t Offset;
+  // Which member is set depends on Type, so a Token stays 32 bytes.
+  union {
+    // IDENT tokens of a Lexer that was given an Interner, else noSymbol
+    SymbolId Symbol;
+    // INT tokens, computed by the lexer from the digits it scanned
+    std::int64_t Value;
+    // FLOAT tokens, likewise
+    double FloatValue;
+    // STRING tokens: whether the body contains a backslash and so has to go
+    // through decodeEscapes() to get its value
+    bool HasEscapes;
+  };
+  std::string_view Literal;
 
-  Token() : Type{}, Literal{} {};
-  Token(std::string_view t, char l) : Type{t}, Literal{std::string{l}} {};
+  Token() : Type{TokenKind::ILLEGAL}, Offset{}, Symbol{noSymbol}, Literal{} {};
+  Token(TokenKind t, std::string_view l, std::uint32_t o = 0)
+      : Type{t}, Offset{o}, Symbol{noSymbol}, Literal{l} {};
 
   // Checks if an identifier is a keyword sets the Token.Type value
-  void setIdentifier(std::string ident);
+  void setIdentifier(std::string_view ident) { Type = lookupIdent(ident); }
 };
 
 // Predefined Identifiers